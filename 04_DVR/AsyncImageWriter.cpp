@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include <bmp.h>
+
+#include "AsyncImageWriter.h"
+
+AsyncImageWriter::AsyncImageWriter(size_t capacity) :
+  capacity(std::max<size_t>(1, capacity)),
+  finished(false),
+  writtenCount(0),
+  failedCount(0),
+  thread(&AsyncImageWriter::run, this)
+{
+}
+
+AsyncImageWriter::~AsyncImageWriter() {
+  finish();
+}
+
+void AsyncImageWriter::push(const std::string& filename, Image image) {
+  std::unique_lock<std::mutex> lock(mutex);
+  queueChanged.wait(lock, [this]{return queue.size() < capacity;});
+  queue.emplace_back(filename, std::move(image));
+  queueChanged.notify_all();
+}
+
+void AsyncImageWriter::finish() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+  }
+  queueChanged.notify_all();
+  if (thread.joinable()) thread.join();
+}
+
+size_t AsyncImageWriter::getWrittenCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return writtenCount;
+}
+
+size_t AsyncImageWriter::getFailedCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return failedCount;
+}
+
+void AsyncImageWriter::run() {
+  while (true) {
+    std::pair<std::string, Image> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queueChanged.wait(lock, [this]{return !queue.empty() || finished;});
+      if (queue.empty()) return;
+      job = std::move(queue.front());
+      queue.pop_front();
+    }
+    queueChanged.notify_all();
+
+    bool success = false;
+    try {
+      success = BMP::save(job.first, job.second);
+    } catch (const BMP::BMPException&) {
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (success) ++writtenCount; else ++failedCount;
+  }
+}
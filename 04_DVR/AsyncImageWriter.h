@@ -0,0 +1,37 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <Image.h>
+
+// Saves images as BMP files on a background thread, so that the threads
+// producing them never wait for the disk. push blocks while capacity
+// images are queued, which bounds the memory held by the queue.
+class AsyncImageWriter {
+public:
+  AsyncImageWriter(size_t capacity=8);
+  ~AsyncImageWriter();
+
+  void push(const std::string& filename, Image image);
+  void finish();
+
+  size_t getWrittenCount() const;
+  size_t getFailedCount() const;
+
+private:
+  size_t capacity;
+  std::deque<std::pair<std::string, Image>> queue;
+  mutable std::mutex mutex;
+  std::condition_variable queueChanged;
+  bool finished;
+  size_t writtenCount;
+  size_t failedCount;
+  std::thread thread;
+
+  void run();
+};
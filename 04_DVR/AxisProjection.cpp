@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "AxisProjection.h"
+
+namespace {
+  struct MaximumOp {
+    typedef uint8_t Value;
+    static const bool skipping = true;
+    static Value initial() {return 0;}
+    static Value combine(Value a, uint8_t b) {return a > b ? a : b;}
+    // the tile bound is the smallest maximum found so far, a brick can only
+    // raise a pixel if its own maximum is larger
+    static Value boundStart() {return 255;}
+    static Value fold(Value bound, Value pixel) {return std::min(bound, pixel);}
+    static bool isHopeless(uint8_t, uint8_t brickMax, Value bound) {return brickMax <= bound;}
+    static bool isSaturated(Value bound) {return bound == 255;}
+  };
+
+  struct MinimumOp {
+    typedef uint8_t Value;
+    static const bool skipping = true;
+    static Value initial() {return 255;}
+    static Value combine(Value a, uint8_t b) {return a < b ? a : b;}
+    static Value boundStart() {return 0;}
+    static Value fold(Value bound, Value pixel) {return std::max(bound, pixel);}
+    static bool isHopeless(uint8_t brickMin, uint8_t, Value bound) {return brickMin >= bound;}
+    static bool isSaturated(Value bound) {return bound == 0;}
+  };
+
+  struct SumOp {
+    typedef uint32_t Value;
+    static const bool skipping = false;
+    static Value initial() {return 0;}
+    static Value combine(Value a, uint8_t b) {return a + b;}
+  };
+}
+
+// axes holds the image x axis, the image y axis and the projection axis
+template <typename Op>
+static std::vector<typename Op::Value> reduce(const Volume& volume, const MacrocellGrid& macrocells,
+                                              const std::array<size_t,3>& axes) {
+  typedef typename Op::Value Value;
+  const std::array<size_t,3> size{volume.width, volume.height, volume.depth};
+  const std::array<size_t,3> stride{1, volume.width, volume.width*volume.height};
+  const std::array<size_t,3> bricks{macrocells.getWidth(), macrocells.getHeight(), macrocells.getDepth()};
+  const size_t brickSize = macrocells.getBrickSize();
+  const size_t i = axes[0];
+  const size_t j = axes[1];
+  const size_t k = axes[2];
+  std::vector<Value> result(size[i]*size[j], Op::initial());
+
+  // along x a tile is several bricks wide, so the inner loop over a row
+  // covers enough voxels to fill the vector registers
+  const size_t tileBricks = i == 0 ? std::max<size_t>(1, 32 / brickSize) : 1;
+  const size_t tilesI = (bricks[i] + tileBricks - 1) / tileBricks;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t tile = 0;tile<int64_t(tilesI*bricks[j]);++tile) {
+    const size_t bi0 = (size_t(tile) % tilesI) * tileBricks;
+    const size_t bi1 = std::min(bi0 + tileBricks, bricks[i]);
+    const size_t bj = size_t(tile) / tilesI;
+    const size_t i0 = bi0 * brickSize;
+    const size_t i1 = std::min(bi1 * brickSize, size[i]);
+    const size_t j0 = bj * brickSize;
+    const size_t j1 = std::min(j0 + brickSize, size[j]);
+
+    [[maybe_unused]] Value bound = Op::initial();
+    for (size_t bk = 0;bk<bricks[k];++bk) {
+      if constexpr (Op::skipping) {
+        bool hopeless = true;
+        for (size_t bi = bi0;bi<bi1 && hopeless;++bi) {
+          std::array<size_t,3> brick;
+          brick[i] = bi;
+          brick[j] = bj;
+          brick[k] = bk;
+          const size_t index = brick[0] + brick[1] * bricks[0] + brick[2] * bricks[0] * bricks[1];
+          hopeless = Op::isHopeless(macrocells.getMinValues()[index], macrocells.getMaxValues()[index], bound);
+        }
+        if (hopeless) continue;
+      }
+
+      const size_t k0 = bk * brickSize;
+      const size_t k1 = std::min(k0 + brickSize, size[k]);
+      for (size_t jj = j0;jj<j1;++jj) {
+        Value* target = result.data() + jj * size[i];
+        if (k == 0) {
+          // projecting along x reduces contiguous row segments
+          for (size_t ii = i0;ii<i1;++ii) {
+            const uint8_t* source = volume.data.data() + ii * stride[i] + jj * stride[j];
+            Value value = target[ii];
+            for (size_t kk = k0;kk<k1;++kk) value = Op::combine(value, source[kk]);
+            target[ii] = value;
+          }
+        } else {
+          for (size_t kk = k0;kk<k1;++kk) {
+            const uint8_t* source = volume.data.data() + jj * stride[j] + kk * stride[k];
+            for (size_t ii = i0;ii<i1;++ii) target[ii] = Op::combine(target[ii], source[ii]);
+          }
+        }
+      }
+
+      if constexpr (Op::skipping) {
+        bound = Op::boundStart();
+        for (size_t jj = j0;jj<j1;++jj) {
+          for (size_t ii = i0;ii<i1;++ii) bound = Op::fold(bound, result[ii + jj * size[i]]);
+        }
+        if (Op::isSaturated(bound)) break;
+      }
+    }
+  }
+  return result;
+}
+
+Image AxisProjection::compute(const Volume& volume, const MacrocellGrid& macrocells,
+                              size_t axis, Compositing compositing) {
+  if (axis > 2) throw std::invalid_argument("AxisProjection: invalid axis");
+
+  const std::array<size_t,3> axes{axis == 0 ? size_t(1) : size_t(0),
+                                  axis == 2 ? size_t(1) : size_t(2), axis};
+  const std::array<size_t,3> size{volume.width, volume.height, volume.depth};
+  Image image{uint32_t(size[axes[0]]), uint32_t(size[axes[1]]), 3};
+
+  std::vector<uint8_t> values;
+  switch (compositing) {
+    case Compositing::Maximum :
+      values = reduce<MaximumOp>(volume, macrocells, axes);
+      break;
+    case Compositing::Minimum :
+      values = reduce<MinimumOp>(volume, macrocells, axes);
+      break;
+    case Compositing::Average : {
+      const std::vector<uint32_t> sums = reduce<SumOp>(volume, macrocells, axes);
+      values.resize(sums.size());
+      for (size_t p = 0;p<sums.size();++p) {
+        values[p] = uint8_t((sums[p] + size[axis]/2) / size[axis]);
+      }
+      break;
+    }
+    case Compositing::EmissionAbsorption :
+      throw std::invalid_argument("AxisProjection: emission-absorption is not a projection");
+  }
+
+  for (size_t p = 0;p<values.size();++p) {
+    image.data[p*3+0] = image.data[p*3+1] = image.data[p*3+2] = values[p];
+  }
+  return image;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Image.h>
+
+#include <Volume.h>
+#include "MacrocellGrid.h"
+#include "Compositing.h"
+
+// Maximum, minimum and average projection of the volume along one of its
+// axes, computed as a direct reduction over the voxel slices instead of
+// marching rays. The output is split into tiles of whole bricks; a brick
+// whose value range cannot change any pixel of its tile is skipped.
+class AxisProjection {
+public:
+  // the image is spanned by the two remaining axes in ascending order,
+  // the compositing mode must not be EmissionAbsorption
+  static Image compute(const Volume& volume, const MacrocellGrid& macrocells,
+                       size_t axis, Compositing compositing);
+};
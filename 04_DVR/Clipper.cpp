@@ -1,5 +1,6 @@
 #include "Clipper.h"
 #include <algorithm>
+#include <array>
 #include <functional>
 
 
@@ -26,6 +27,25 @@ static bool rayPlaneIntersection(const Vec3 &la,
 }
 
 
+// Rotates the triangle (keeping its orientation) such that c is the vertex
+// that lies alone on its side of the plane.
+static void isolateVertex(Vec3& a, Vec3& b, Vec3& c,
+                          float& fa, float& fb, float& fc) {
+  // if fa*fc is non-negative, both have the same sign -- and thus are on the
+  // same side of the plane.
+  if(fa*fc >= 0) {
+    std::swap(fb, fc);
+    std::swap(b, c);
+    std::swap(fa, fb);
+    std::swap(a, b);
+  } else if(fb*fc >= 0) {
+    std::swap(fa, fc);
+    std::swap(a, c);
+    std::swap(fa, fb);
+    std::swap(a, b);
+  }
+}
+
 // Splits a triangle along a plane with the given normal.
 // Assumes: plane's D == 0.
 //          triangle does span the plane.
@@ -49,19 +69,7 @@ static void splitTriangle(Vec3 a,
   //       o-------o      reduces the number of cases below.
   //      a         b
 
-  // if fa*fc is non-negative, both have the same sign -- and thus are on the
-  // same side of the plane.
-  if(fa*fc >= 0) {
-    std::swap(fb, fc);
-    std::swap(b, c);
-    std::swap(fa, fb);
-    std::swap(a, b);
-  } else if(fb*fc >= 0) {
-    std::swap(fa, fc);
-    std::swap(a, c);
-    std::swap(fa, fb);
-    std::swap(a, b);
-  }
+  isolateVertex(a, b, c, fa, fb, fc);
 
   // Find the intersection points.
   Vec3 A, B;
@@ -195,3 +203,130 @@ std::vector<float> Clipper::meshPlane(std::vector<float> posData,
   meshPlane(vecPos, normal, D);
   return vec3toRaw(vecPos);
 }
+
+static float planeDistance(const Vec3& p, const Vec3 &normal, const float D) {
+  const float f = Vec3::dot(normal, p) + D;
+  return fabs(f) < (2 * std::numeric_limits<float>::epsilon()) ? 0.0f : f;
+}
+
+static Vec3 loadVertex(const float* posData, size_t i) {
+  return Vec3{posData[i*3+0],posData[i*3+1],posData[i*3+2]};
+}
+
+static void storeTriangle(float* posData, size_t i,
+                          const Vec3& a, const Vec3& b, const Vec3& c) {
+  for (const Vec3& v : {a, b, c}) {
+    posData[i*3+0] = v.x;
+    posData[i*3+1] = v.y;
+    posData[i*3+2] = v.z;
+    ++i;
+  }
+}
+
+namespace {
+  // fixed capacity replacement of the sort/unique/angle sort sequence above
+  struct CapPolygon {
+    struct Vertex {
+      Vec3 position;
+      float angle;
+    };
+    std::array<Vertex, Clipper::maxCapVertices> vertices;
+    size_t count{0};
+
+    void add(const Vec3& p) {
+      for (size_t i = 0;i<count;++i) {
+        if ((vertices[i].position-p).sqlength() <= 1e-12f) return;
+      }
+      if (count == vertices.size())
+        throw ClipperException("Clipper: cap polygon exceeds maxCapVertices");
+      vertices[count++].position = p;
+    }
+
+    void sortCounterClockwise(const Vec3& normal) {
+      Vec3 center;
+      for (size_t i = 0;i<count;++i) {
+        center = center + vertices[i].position;
+      }
+      center = center / float(count);
+
+      const Vec3 refVec = Vec3::normalize(vertices[0].position-center);
+      for (size_t i = 0;i<count;++i) {
+        const Vec3 vec = Vec3::normalize(vertices[i].position-center);
+        vertices[i].angle = atan2(Vec3::dot(Vec3::cross(vec, refVec), normal),
+                                  Vec3::dot(refVec, vec));
+      }
+      std::sort(vertices.begin(), vertices.begin()+count,
+                [](const Vertex& i, const Vertex& j) {return i.angle > j.angle;});
+    }
+  };
+}
+
+size_t Clipper::meshPlane(float* posData, size_t vertexCount, size_t capacity,
+                          const Vec3 &normal, const float D) {
+  CapPolygon cap;
+
+  // surviving triangles are compacted towards the front of the buffer, the
+  // second triangle of a split quad is parked behind the input and moved
+  // down afterwards
+  size_t kept = 0;
+  size_t parked = vertexCount;
+  for (size_t i = 0;i+2<vertexCount;i+=3) {
+    Vec3 a = loadVertex(posData, i+0);
+    Vec3 b = loadVertex(posData, i+1);
+    Vec3 c = loadVertex(posData, i+2);
+    float fa = planeDistance(a, normal, D);
+    float fb = planeDistance(b, normal, D);
+    float fc = planeDistance(c, normal, D);
+
+    if(fa >= 0 && fb >= 0 && fc >= 0) {        // trivial reject
+      continue;
+    } else if(fa <= 0 && fb <= 0 && fc <= 0) { // trivial accept
+      storeTriangle(posData, kept, a, b, c);
+      kept += 3;
+      continue;
+    }
+
+    isolateVertex(a, b, c, fa, fb, fc);
+    Vec3 A, B;
+    rayPlaneIntersection(a,c, normal,D, A);
+    rayPlaneIntersection(b,c, normal,D, B);
+
+    if(fc >= 0) {
+      if (parked+3 > capacity)
+        throw ClipperException("Clipper: vertex buffer capacity exceeded");
+      storeTriangle(posData, kept, a, b, A);
+      storeTriangle(posData, parked, b, B, A);
+      kept += 3;
+      parked += 3;
+    } else {
+      storeTriangle(posData, kept, A, B, c);
+      kept += 3;
+    }
+    cap.add(A);
+    cap.add(B);
+  }
+
+  std::copy(posData+vertexCount*3, posData+parked*3, posData+kept*3);
+  kept += parked-vertexCount;
+
+  if (cap.count < 3) return kept;
+
+  // close the polytope with a triangle fan over the cap polygon
+  cap.sortCounterClockwise(normal);
+  if (kept + (cap.count-2)*3 > capacity)
+    throw ClipperException("Clipper: vertex buffer capacity exceeded");
+  for (size_t i = 2;i<cap.count;++i) {
+    storeTriangle(posData, kept, cap.vertices[0].position,
+                  cap.vertices[i-1].position, cap.vertices[i].position);
+    kept += 3;
+  }
+  return kept;
+}
+
+size_t Clipper::meshPlanes(float* posData, size_t vertexCount, size_t capacity,
+                           const Vec4* planes, size_t planeCount) {
+  for (size_t i = 0;i<planeCount;++i) {
+    vertexCount = meshPlane(posData, vertexCount, capacity, planes[i].xyz, planes[i].w);
+  }
+  return vertexCount;
+}
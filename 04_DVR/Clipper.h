@@ -1,7 +1,19 @@
 #pragma once
 
+#include <string>
 #include <vector>
 #include <Vec3.h>
+#include <Vec4.h>
+
+class ClipperException : public std::exception {
+public:
+  ClipperException(const std::string& whatStr) : whatStr(whatStr) {}
+  virtual const char* what() const throw() {
+    return whatStr.c_str();
+  }
+private:
+  std::string whatStr;
+};
 
 class Clipper {
 public:
@@ -12,4 +24,16 @@ public:
 
   static std::vector<float> meshPlane(std::vector<float> posData, const Vec3 &normal,
                        const float D);
+
+  // Allocation free clipping of a closed convex triangle mesh, stored as
+  // xyz triplets in a caller owned buffer with room for capacity vertices.
+  // The mesh is clipped in place against the planes dot(normal,p)+D = 0,
+  // keeping the negative side, and the clipped mesh is closed with a cap
+  // polygon per plane. Returns the new vertex count.
+  static size_t meshPlane(float* posData, size_t vertexCount, size_t capacity,
+                          const Vec3 &normal, const float D);
+  static size_t meshPlanes(float* posData, size_t vertexCount, size_t capacity,
+                           const Vec4* planes, size_t planeCount);
+
+  static const size_t maxCapVertices = 64;
 };
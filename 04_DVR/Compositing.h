@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+// How the samples along a ray are combined, the numbering matches the
+// compositing uniform of cubeFS.glsl
+enum class Compositing {
+  EmissionAbsorption = 0,
+  Maximum = 1,
+  Minimum = 2,
+  Average = 3
+};
+
+inline std::string toString(Compositing compositing) {
+  switch (compositing) {
+    case Compositing::EmissionAbsorption : return "emission-absorption";
+    case Compositing::Maximum            : return "maximum intensity projection";
+    case Compositing::Minimum            : return "minimum intensity projection";
+    case Compositing::Average            : return "average intensity projection";
+  }
+  return "";
+}
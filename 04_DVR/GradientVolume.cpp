@@ -0,0 +1,52 @@
+#include <algorithm>
+#include <cmath>
+
+#include "GradientVolume.h"
+
+GradientVolume::GradientVolume() :
+  width(0),
+  height(0),
+  depth(0)
+{
+}
+
+void GradientVolume::build(const Volume& volume) {
+  width = volume.width;
+  height = volume.height;
+  depth = volume.depth;
+  data.resize(width*height*depth*3);
+
+  const size_t strides[3] = {1, width, width*height};
+
+  #pragma omp parallel for
+  for (int64_t w = 0;w<int64_t(depth);++w) {
+    for (size_t v = 0;v<height;++v) {
+      for (size_t u = 0;u<width;++u) {
+        const size_t coords[3] = {u, v, size_t(w)};
+        const size_t sizes[3] = {width, height, depth};
+        const size_t index = u + v * width + size_t(w) * width * height;
+
+        // one-sided differences at the border of the volume
+        Vec3 gradient;
+        for (size_t a = 0;a<3;++a) {
+          const size_t prev = coords[a] > 0 ? index - strides[a] : index;
+          const size_t next = coords[a]+1 < sizes[a] ? index + strides[a] : index;
+          gradient.e[a] = float(volume.data[next]) - float(volume.data[prev]);
+        }
+
+        // only the direction is stored, homogeneous regions map to zero
+        const float length = gradient.length();
+        const Vec3 direction = length > 0.0f ? gradient / length : Vec3{0.0f,0.0f,0.0f};
+        for (size_t a = 0;a<3;++a) {
+          data[index*3+a] = uint8_t(std::clamp(direction.e[a] * 127.5f + 128.0f, 0.0f, 255.0f));
+        }
+      }
+    }
+  }
+}
+
+void GradientVolume::clear() {
+  width = height = depth = 0;
+  data.clear();
+  data.shrink_to_fit();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include <Volume.h>
+
+// Central difference gradients of a volume, stored as RGB8 directions for
+// upload as a 3D texture. Costs three bytes per voxel on top of the scalar
+// volume (usually padded to four on the GPU), in exchange the shader saves
+// the six extra fetches of on-the-fly differences per sample.
+class GradientVolume {
+public:
+  GradientVolume();
+
+  void build(const Volume& volume);
+  void clear();
+
+  bool isEmpty() const {return data.empty();}
+  const std::vector<uint8_t>& getData() const {return data;}
+  size_t getMemoryFootprint() const {return data.size();}
+
+  size_t getWidth() const {return width;}
+  size_t getHeight() const {return height;}
+  size_t getDepth() const {return depth;}
+
+private:
+  size_t width;
+  size_t height;
+  size_t depth;
+  std::vector<uint8_t> data;
+};
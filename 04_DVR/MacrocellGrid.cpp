@@ -0,0 +1,75 @@
+#include <algorithm>
+
+#include "MacrocellGrid.h"
+
+MacrocellGrid::MacrocellGrid(size_t brickSize) :
+  brickSize(brickSize),
+  width(0),
+  height(0),
+  depth(0)
+{
+}
+
+void MacrocellGrid::build(const Volume& volume) {
+  width  = (volume.width  + brickSize - 1) / brickSize;
+  height = (volume.height + brickSize - 1) / brickSize;
+  depth  = (volume.depth  + brickSize - 1) / brickSize;
+  scale = Vec3{float(volume.width), float(volume.height), float(volume.depth)} / float(brickSize);
+
+  minValues.resize(width*height*depth);
+  maxValues.resize(width*height*depth);
+  occupancy.resize(width*height*depth);
+
+  // the bricks overlap their neighbors by one voxel, as trilinear
+  // interpolation close to a brick border also reads the adjacent voxels
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(width*height*depth);++i) {
+    const size_t bu = size_t(i) % width;
+    const size_t bv = (size_t(i) / width) % height;
+    const size_t bw = size_t(i) / (width * height);
+
+    const size_t startU = bu > 0 ? bu*brickSize-1 : 0;
+    const size_t startV = bv > 0 ? bv*brickSize-1 : 0;
+    const size_t startW = bw > 0 ? bw*brickSize-1 : 0;
+    const size_t endU = std::min(volume.width,  (bu+1)*brickSize+1);
+    const size_t endV = std::min(volume.height, (bv+1)*brickSize+1);
+    const size_t endW = std::min(volume.depth,  (bw+1)*brickSize+1);
+
+    uint8_t minVal = 255;
+    uint8_t maxVal = 0;
+    for (size_t w = startW;w<endW;++w) {
+      for (size_t v = startV;v<endV;++v) {
+        const uint8_t* row = volume.data.data() + (v + w * volume.height) * volume.width;
+        for (size_t u = startU;u<endU;++u) {
+          minVal = std::min(minVal, row[u]);
+          maxVal = std::max(maxVal, row[u]);
+        }
+      }
+    }
+
+    minValues[size_t(i)] = minVal;
+    maxValues[size_t(i)] = maxVal;
+  }
+}
+
+void MacrocellGrid::classify(const std::array<float, 256>& opacity) {
+  // prefix sum over the visible entries of the table, so every brick is
+  // classified with a single range query instead of a scan over [min,max]
+  std::array<uint16_t, 257> visibleCount{};
+  for (size_t i = 0;i<opacity.size();++i) {
+    visibleCount[i+1] = uint16_t(visibleCount[i] + (opacity[i] > 0.0f ? 1 : 0));
+  }
+
+  for (size_t i = 0;i<occupancy.size();++i) {
+    occupancy[i] = visibleCount[maxValues[i]+1] - visibleCount[minValues[i]] > 0 ? 255 : 0;
+  }
+}
+
+std::vector<uint8_t> MacrocellGrid::getRanges() const {
+  std::vector<uint8_t> ranges(minValues.size()*2);
+  for (size_t i = 0;i<minValues.size();++i) {
+    ranges[i*2+0] = minValues[i];
+    ranges[i*2+1] = maxValues[i];
+  }
+  return ranges;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Vec3.h>
+
+#include <Volume.h>
+
+// Coarse grid of min/max values over bricks of brickSize^3 voxels. The
+// min/max pass runs once per volume, classifying the bricks against a
+// transfer function only touches the (small) brick grid and is therefore
+// cheap enough to be repeated on every transfer function change.
+class MacrocellGrid {
+public:
+  MacrocellGrid(size_t brickSize=8);
+
+  void build(const Volume& volume);
+  void classify(const std::array<float, 256>& opacity);
+
+  size_t getBrickSize() const {return brickSize;}
+  size_t getWidth() const {return width;}
+  size_t getHeight() const {return height;}
+  size_t getDepth() const {return depth;}
+  Vec3 getScale() const {return scale;}
+
+  const std::vector<uint8_t>& getOccupancy() const {return occupancy;}
+  const std::vector<uint8_t>& getMinValues() const {return minValues;}
+  const std::vector<uint8_t>& getMaxValues() const {return maxValues;}
+  std::vector<uint8_t> getRanges() const;
+
+private:
+  size_t brickSize;
+  size_t width;
+  size_t height;
+  size_t depth;
+  Vec3 scale;
+
+  std::vector<uint8_t> minValues;
+  std::vector<uint8_t> maxValues;
+  std::vector<uint8_t> occupancy;
+};
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define PACKET_KERNEL_X86
+#endif
+
+// Everything the packet kernel needs for one frame, all vectors are given in
+// texture space. The origin of the ray through pixel (u,v) is
+// origin + u*stepU + v*stepV, sample n of that ray is at origin + n*delta.
+struct PacketKernelParams {
+  const uint8_t* volume;      // padded by 3 bytes for 32 bit gathers
+  int32_t sizeX;
+  int32_t sizeY;
+  int32_t sizeZ;
+  const float* colorTable;    // premultiplied r,g,b,a tables of 256 entries
+  const uint8_t* occupancy;   // macrocell occupancy, padded by 3 bytes as well
+  int32_t bricksX;
+  int32_t bricksY;
+  int32_t bricksZ;
+  float brickScale[3];        // bricks per unit texture coordinate
+  float origin[3];
+  float stepU[3];
+  float stepV[3];
+  float delta[3];
+  float minBounds[3];
+  float maxBounds[3];
+  float background[3];
+  int32_t compositing;        // numbered as the Compositing enum
+  uint32_t width;
+  uint8_t* image;             // RGB, one row of width pixels after the other
+};
+
+void tracePacketRowScalar(const PacketKernelParams& params, uint32_t row);
+#ifdef PACKET_KERNEL_X86
+void tracePacketRowSSE(const PacketKernelParams& params, uint32_t row);
+void tracePacketRowAVX2(const PacketKernelParams& params, uint32_t row);
+void tracePacketRowAVX512(const PacketKernelParams& params, uint32_t row);
+#endif
+
+// The kernel is written once against a small SIMD interface S (float
+// vector F, int vector I, lane mask M) and instantiated by the translation
+// unit of each instruction set. It has to be included after the target
+// options of that unit are in effect, otherwise the compiler refuses to
+// inline the intrinsics into it.
+namespace PacketKernel {
+
+  template <typename S>
+  typename S::F lerp(typename S::F a, typename S::F b, typename S::F t) {
+    return S::add(a, S::mul(S::sub(b, a), t));
+  }
+
+  // voxel pair at index and index+1 as the two low bytes of a 32 bit gather
+  template <typename S>
+  typename S::F lerpPair(typename S::I pair, typename S::F t) {
+    const typename S::I mask = S::iset1(0xFF);
+    const typename S::F a = S::toFloat(S::iand(pair, mask));
+    const typename S::F b = S::toFloat(S::iand(S::srli8(pair), mask));
+    return lerp<S>(a, b, t);
+  }
+
+  // trilinear reconstruction in [0,255], coordinates are clamped to the
+  // volume so that masked lanes with arbitrary positions stay in bounds
+  template <typename S>
+  typename S::F sample(const PacketKernelParams& p, const typename S::F pos[3]) {
+    typedef typename S::F F;
+    typedef typename S::I I;
+    const int32_t size[3] = {p.sizeX, p.sizeY, p.sizeZ};
+
+    F weight[3];
+    I cell[3];
+    for (size_t a = 0;a<3;++a) {
+      const F q = S::min(S::max(S::sub(S::mul(pos[a], S::set1(float(size[a]))), S::set1(0.5f)),
+                                S::set1(0.0f)),
+                         S::set1(float(size[a]-1)));
+      const F q0 = S::min(S::floor(q), S::set1(float(size[a] > 1 ? size[a]-2 : 0)));
+      weight[a] = S::sub(q, q0);
+      cell[a] = S::toInt(q0);
+    }
+
+    const int32_t sliceSize = p.sizeX * p.sizeY;
+    const I index = S::iadd(S::iadd(cell[0], S::imul(cell[1], S::iset1(p.sizeX))),
+                            S::imul(cell[2], S::iset1(sliceSize)));
+    const F c00 = lerpPair<S>(S::gatherPair(p.volume, index), weight[0]);
+    const F c10 = lerpPair<S>(S::gatherPair(p.volume, S::iadd(index, S::iset1(p.sizeX))), weight[0]);
+    const F c01 = lerpPair<S>(S::gatherPair(p.volume, S::iadd(index, S::iset1(sliceSize))), weight[0]);
+    const F c11 = lerpPair<S>(S::gatherPair(p.volume, S::iadd(index, S::iset1(sliceSize+p.sizeX))), weight[0]);
+    return lerp<S>(lerp<S>(c00, c10, weight[1]), lerp<S>(c01, c11, weight[1]), weight[2]);
+  }
+
+  // samples to advance from pos: lanes in a visible macrocell take a single
+  // step, lanes in an empty one leap to the first sample past its exit
+  template <typename S>
+  typename S::F leap(const PacketKernelParams& p, const typename S::F pos[3], typename S::M& visible) {
+    typedef typename S::F F;
+    typedef typename S::I I;
+    const int32_t bricks[3] = {p.bricksX, p.bricksY, p.bricksZ};
+    const F zero = S::set1(0.0f);
+
+    I cell[3];
+    F exit = S::set1(1e30f);
+    for (size_t a = 0;a<3;++a) {
+      const F b = S::mul(pos[a], S::set1(p.brickScale[a]));
+      const F b0 = S::min(S::max(S::floor(b), zero), S::set1(float(bricks[a]-1)));
+      cell[a] = S::toInt(b0);
+      const float brickDelta = p.delta[a] * p.brickScale[a];
+      if (brickDelta == 0.0f) continue;
+      const F face = brickDelta > 0.0f ? S::add(b0, S::set1(1.0f)) : b0;
+      exit = S::min(exit, S::mul(S::sub(face, b), S::set1(1.0f / brickDelta)));
+    }
+
+    const I index = S::iadd(S::iadd(cell[0], S::imul(cell[1], S::iset1(p.bricksX))),
+                            S::imul(cell[2], S::iset1(p.bricksX * p.bricksY)));
+    const F occupied = S::toFloat(S::iand(S::gatherPair(p.occupancy, index), S::iset1(0xFF)));
+    visible = S::lt(zero, occupied);
+
+    const F skip = S::max(S::sub(zero, S::floor(S::sub(zero, exit))), S::set1(1.0f));
+    return S::select(visible, S::set1(1.0f), skip);
+  }
+
+  // maximum, minimum or average of the samples, lanes that hit the volume
+  // become opaque gray so the background blend of traceRow stays the same
+  template <typename S>
+  void project(const PacketKernelParams& p, const typename S::F origin[3],
+               typename S::F t, typename S::F tFar, typename S::M active,
+               typename S::F color[4]) {
+    typedef typename S::F F;
+    const F one = S::set1(1.0f);
+    const F zero = S::set1(0.0f);
+    const F hit = S::select(active, one, zero);
+
+    F value = S::set1(p.compositing == 2 ? 255.0f : 0.0f);
+    F count = zero;
+    while (S::any(active)) {
+      F pos[3];
+      for (size_t a = 0;a<3;++a) pos[a] = S::add(origin[a], S::mul(t, S::set1(p.delta[a])));
+      const F current = sample<S>(p, pos);
+
+      F combined;
+      switch (p.compositing) {
+        case 1  : combined = S::max(value, current); break;
+        case 2  : combined = S::min(value, current); break;
+        default : combined = S::add(value, current); break;
+      }
+      value = S::select(active, combined, value);
+      count = S::add(count, S::select(active, one, zero));
+
+      t = S::add(t, one);
+      active = S::mand(active, S::le(t, tFar));
+      // nothing can change a saturated maximum or minimum
+      if (p.compositing == 1) active = S::mand(active, S::lt(value, S::set1(255.0f)));
+      if (p.compositing == 2) active = S::mand(active, S::lt(zero, value));
+    }
+    if (p.compositing == 3) value = S::div(value, S::max(count, one));
+
+    const F gray = S::mul(S::mul(value, S::set1(1.0f / 255.0f)), hit);
+    for (size_t c = 0;c<3;++c) color[c] = gray;
+    color[3] = hit;
+  }
+
+  template <typename S>
+  void traceRow(const PacketKernelParams& p, uint32_t row) {
+    typedef typename S::F F;
+    typedef typename S::I I;
+    typedef typename S::M M;
+    const float inf = 1e30f;
+
+    float rowOrigin[3];
+    for (size_t a = 0;a<3;++a) rowOrigin[a] = p.origin[a] + p.stepV[a] * float(row);
+
+    for (uint32_t u0 = 0;u0<p.width;u0+=S::width) {
+      const F u = S::add(S::set1(float(u0)), S::laneIndex());
+      M active = S::lt(u, S::set1(float(p.width)));
+
+      // clip the packet against the bounding box
+      F origin[3];
+      F tNear = S::set1(-inf);
+      F tFar = S::set1(inf);
+      for (size_t a = 0;a<3;++a) {
+        origin[a] = S::add(S::set1(rowOrigin[a]), S::mul(u, S::set1(p.stepU[a])));
+        if (p.delta[a] == 0.0f) {
+          active = S::mand(active, S::mand(S::le(S::set1(p.minBounds[a]), origin[a]),
+                                           S::le(origin[a], S::set1(p.maxBounds[a]))));
+          continue;
+        }
+        const F invDelta = S::set1(1.0f / p.delta[a]);
+        const F t0 = S::mul(S::sub(S::set1(p.minBounds[a]), origin[a]), invDelta);
+        const F t1 = S::mul(S::sub(S::set1(p.maxBounds[a]), origin[a]), invDelta);
+        tNear = S::max(tNear, S::min(t0, t1));
+        tFar = S::min(tFar, S::max(t0, t1));
+      }
+      active = S::mand(active, S::le(tNear, tFar));
+      F t = S::select(active, tNear, S::set1(0.0f));
+
+      F color[4] = {S::set1(0.0f), S::set1(0.0f), S::set1(0.0f), S::set1(0.0f)};
+      if (p.compositing != 0) project<S>(p, origin, t, tFar, active, color);
+      // the projections ignore the transfer function and can't skip
+      // macrocells, emission-absorption samples in empty ones are zero
+      while (p.compositing == 0 && S::any(active)) {
+        F pos[3];
+        for (size_t a = 0;a<3;++a) pos[a] = S::add(origin[a], S::mul(t, S::set1(p.delta[a])));
+        M visible;
+        const F step = leap<S>(p, pos, visible);
+        const M composite = S::mand(active, visible);
+
+        if (S::any(composite)) {
+          const F value = sample<S>(p, pos);
+
+          // linear transfer function lookup
+          const F entry = S::floor(value);
+          const F fraction = S::sub(value, entry);
+          const I index0 = S::toInt(entry);
+          const I index1 = S::imin(S::iadd(index0, S::iset1(1)), S::iset1(255));
+
+          // front-to-back compositing, terminated lanes get a zero weight
+          const F weight = S::select(composite, S::sub(S::set1(1.0f), color[3]), S::set1(0.0f));
+          for (size_t c = 0;c<4;++c) {
+            const float* table = p.colorTable + c * 256;
+            const F current = lerp<S>(S::gather(table, index0), S::gather(table, index1), fraction);
+            color[c] = S::add(color[c], S::mul(weight, current));
+          }
+        }
+
+        t = S::add(t, step);
+        active = S::mand(active, S::mand(S::le(t, tFar), S::lt(color[3], S::set1(0.99f))));
+      }
+
+      float lanes[4][S::width];
+      for (size_t c = 0;c<4;++c) S::store(lanes[c], color[c]);
+      uint8_t* target = p.image + (size_t(row) * p.width + u0) * 3;
+      for (uint32_t i = 0;i<S::width && u0+i<p.width;++i) {
+        for (size_t c = 0;c<3;++c) {
+          const float v = lanes[c][i] + (1.0f - lanes[3][i]) * p.background[c];
+          *target++ = uint8_t((v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v)) * 255.0f);
+        }
+      }
+    }
+  }
+
+}
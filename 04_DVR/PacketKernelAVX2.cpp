@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to=function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+// included inside the target region, see PacketKernel.h
+#include "PacketKernel.h"
+
+namespace {
+  // 8 rays per packet
+  struct SimdAVX2 {
+    typedef __m256 F;
+    typedef __m256i I;
+    typedef __m256 M;
+    static const uint32_t width = 8;
+
+    static F set1(float v) {return _mm256_set1_ps(v);}
+    static F laneIndex() {return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);}
+    static F add(F a, F b) {return _mm256_add_ps(a, b);}
+    static F sub(F a, F b) {return _mm256_sub_ps(a, b);}
+    static F mul(F a, F b) {return _mm256_mul_ps(a, b);}
+    static F div(F a, F b) {return _mm256_div_ps(a, b);}
+    static F min(F a, F b) {return _mm256_min_ps(a, b);}
+    static F max(F a, F b) {return _mm256_max_ps(a, b);}
+    static F floor(F a) {return _mm256_floor_ps(a);}
+    static void store(float* target, F a) {_mm256_storeu_ps(target, a);}
+
+    static M lt(F a, F b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+    static M le(F a, F b) {return _mm256_cmp_ps(a, b, _CMP_LE_OQ);}
+    static M mand(M a, M b) {return _mm256_and_ps(a, b);}
+    static F select(M m, F a, F b) {return _mm256_blendv_ps(b, a, m);}
+    static bool any(M m) {return _mm256_movemask_ps(m) != 0;}
+
+    static I iset1(int32_t v) {return _mm256_set1_epi32(v);}
+    static I iadd(I a, I b) {return _mm256_add_epi32(a, b);}
+    static I imul(I a, I b) {return _mm256_mullo_epi32(a, b);}
+    static I imin(I a, I b) {return _mm256_min_epi32(a, b);}
+    static I iand(I a, I b) {return _mm256_and_si256(a, b);}
+    static I srli8(I a) {return _mm256_srli_epi32(a, 8);}
+    static I toInt(F a) {return _mm256_cvttps_epi32(a);}
+    static F toFloat(I a) {return _mm256_cvtepi32_ps(a);}
+
+    static I gatherPair(const uint8_t* base, I index) {
+      return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), index, 1);
+    }
+
+    static F gather(const float* base, I index) {
+      return _mm256_i32gather_ps(base, index, 4);
+    }
+  };
+}
+
+void tracePacketRowAVX2(const PacketKernelParams& params, uint32_t row) {
+  PacketKernel::traceRow<SimdAVX2>(params, row);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
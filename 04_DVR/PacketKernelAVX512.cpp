@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+// GCC 12 reports the undefined vectors inside its AVX-512 intrinsics as
+// uninitialized
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f"))), apply_to=function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+// included inside the target region, see PacketKernel.h
+#include "PacketKernel.h"
+
+namespace {
+  // 16 rays per packet, lane masks live in mask registers
+  struct SimdAVX512 {
+    typedef __m512 F;
+    typedef __m512i I;
+    typedef __mmask16 M;
+    static const uint32_t width = 16;
+
+    static F set1(float v) {return _mm512_set1_ps(v);}
+    static F laneIndex() {return _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+                                                8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);}
+    static F add(F a, F b) {return _mm512_add_ps(a, b);}
+    static F sub(F a, F b) {return _mm512_sub_ps(a, b);}
+    static F mul(F a, F b) {return _mm512_mul_ps(a, b);}
+    static F div(F a, F b) {return _mm512_div_ps(a, b);}
+    static F min(F a, F b) {return _mm512_min_ps(a, b);}
+    static F max(F a, F b) {return _mm512_max_ps(a, b);}
+    static F floor(F a) {return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF);}
+    static void store(float* target, F a) {_mm512_storeu_ps(target, a);}
+
+    static M lt(F a, F b) {return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);}
+    static M le(F a, F b) {return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);}
+    static M mand(M a, M b) {return M(a & b);}
+    static F select(M m, F a, F b) {return _mm512_mask_blend_ps(m, b, a);}
+    static bool any(M m) {return m != 0;}
+
+    static I iset1(int32_t v) {return _mm512_set1_epi32(v);}
+    static I iadd(I a, I b) {return _mm512_add_epi32(a, b);}
+    static I imul(I a, I b) {return _mm512_mullo_epi32(a, b);}
+    static I imin(I a, I b) {return _mm512_min_epi32(a, b);}
+    static I iand(I a, I b) {return _mm512_and_si512(a, b);}
+    static I srli8(I a) {return _mm512_srli_epi32(a, 8);}
+    static I toInt(F a) {return _mm512_cvttps_epi32(a);}
+    static F toFloat(I a) {return _mm512_cvtepi32_ps(a);}
+
+    static I gatherPair(const uint8_t* base, I index) {
+      return _mm512_i32gather_epi32(index, base, 1);
+    }
+
+    static F gather(const float* base, I index) {
+      return _mm512_i32gather_ps(index, base, 4);
+    }
+  };
+}
+
+void tracePacketRowAVX512(const PacketKernelParams& params, uint32_t row) {
+  PacketKernel::traceRow<SimdAVX512>(params, row);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#include <immintrin.h>
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse4.1"))), apply_to=function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("sse4.1")
+#endif
+
+// included inside the target region, see PacketKernel.h
+#include "PacketKernel.h"
+
+namespace {
+  // 4 rays per packet, SSE has no gather so these are assembled from scalar
+  // loads
+  struct SimdSSE {
+    typedef __m128 F;
+    typedef __m128i I;
+    typedef __m128 M;
+    static const uint32_t width = 4;
+
+    static F set1(float v) {return _mm_set1_ps(v);}
+    static F laneIndex() {return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);}
+    static F add(F a, F b) {return _mm_add_ps(a, b);}
+    static F sub(F a, F b) {return _mm_sub_ps(a, b);}
+    static F mul(F a, F b) {return _mm_mul_ps(a, b);}
+    static F div(F a, F b) {return _mm_div_ps(a, b);}
+    static F min(F a, F b) {return _mm_min_ps(a, b);}
+    static F max(F a, F b) {return _mm_max_ps(a, b);}
+    static F floor(F a) {return _mm_floor_ps(a);}
+    static void store(float* target, F a) {_mm_storeu_ps(target, a);}
+
+    static M lt(F a, F b) {return _mm_cmplt_ps(a, b);}
+    static M le(F a, F b) {return _mm_cmple_ps(a, b);}
+    static M mand(M a, M b) {return _mm_and_ps(a, b);}
+    static F select(M m, F a, F b) {return _mm_blendv_ps(b, a, m);}
+    static bool any(M m) {return _mm_movemask_ps(m) != 0;}
+
+    static I iset1(int32_t v) {return _mm_set1_epi32(v);}
+    static I iadd(I a, I b) {return _mm_add_epi32(a, b);}
+    static I imul(I a, I b) {return _mm_mullo_epi32(a, b);}
+    static I imin(I a, I b) {return _mm_min_epi32(a, b);}
+    static I iand(I a, I b) {return _mm_and_si128(a, b);}
+    static I srli8(I a) {return _mm_srli_epi32(a, 8);}
+    static I toInt(F a) {return _mm_cvttps_epi32(a);}
+    static F toFloat(I a) {return _mm_cvtepi32_ps(a);}
+
+    static I gatherPair(const uint8_t* base, I index) {
+      alignas(16) int32_t i[4];
+      alignas(16) int32_t v[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(i), index);
+      for (size_t l = 0;l<4;++l) std::memcpy(&v[l], base + i[l], sizeof(int32_t));
+      return _mm_load_si128(reinterpret_cast<const __m128i*>(v));
+    }
+
+    static F gather(const float* base, I index) {
+      alignas(16) int32_t i[4];
+      _mm_store_si128(reinterpret_cast<__m128i*>(i), index);
+      return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+    }
+  };
+}
+
+void tracePacketRowSSE(const PacketKernelParams& params, uint32_t row) {
+  PacketKernel::traceRow<SimdSSE>(params, row);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
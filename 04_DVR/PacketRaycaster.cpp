@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cmath>
+
+#include "PacketKernel.h"
+#include "PacketRaycaster.h"
+
+#if defined(PACKET_KERNEL_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace {
+  // one ray at a time, used on processors without the vector extensions
+  struct SimdScalar {
+    typedef float F;
+    typedef int32_t I;
+    typedef bool M;
+    static const uint32_t width = 1;
+
+    static F set1(float v) {return v;}
+    static F laneIndex() {return 0.0f;}
+    static F add(F a, F b) {return a + b;}
+    static F sub(F a, F b) {return a - b;}
+    static F mul(F a, F b) {return a * b;}
+    static F div(F a, F b) {return a / b;}
+    // operand order as in minps/maxps, a NaN in a yields b
+    static F min(F a, F b) {return a < b ? a : b;}
+    static F max(F a, F b) {return a > b ? a : b;}
+    static F floor(F a) {return std::floor(a);}
+    static void store(float* target, F a) {*target = a;}
+
+    static M lt(F a, F b) {return a < b;}
+    static M le(F a, F b) {return a <= b;}
+    static M mand(M a, M b) {return a && b;}
+    static F select(M m, F a, F b) {return m ? a : b;}
+    static bool any(M m) {return m;}
+
+    static I iset1(int32_t v) {return v;}
+    static I iadd(I a, I b) {return a + b;}
+    static I imul(I a, I b) {return a * b;}
+    static I imin(I a, I b) {return std::min(a, b);}
+    static I iand(I a, I b) {return a & b;}
+    static I srli8(I a) {return int32_t(uint32_t(a) >> 8);}
+    static I toInt(F a) {return int32_t(a);}
+    static F toFloat(I a) {return float(a);}
+
+    static I gatherPair(const uint8_t* base, I index) {return base[index] | (base[index+1] << 8);}
+    static F gather(const float* base, I index) {return base[index];}
+  };
+}
+
+void tracePacketRowScalar(const PacketKernelParams& params, uint32_t row) {
+  PacketKernel::traceRow<SimdScalar>(params, row);
+}
+
+PacketRaycaster::PacketRaycaster() :
+  voxelCount{0, 0, 0},
+  brickCount{0, 0, 0},
+  packetSize(supportedPacketSize()),
+  compositing(Compositing::EmissionAbsorption)
+{
+}
+
+void PacketRaycaster::build(const Volume& volume) {
+  voxelCount = {volume.width, volume.height, volume.depth};
+  // the vector units gather 32 bit words starting at the last voxel
+  paddedData.resize(volume.data.size() + 3);
+  std::copy(volume.data.begin(), volume.data.end(), paddedData.begin());
+}
+
+void PacketRaycaster::classify(const TransferFunction& transferFunction, const MacrocellGrid& macrocells) {
+  this->transferFunction = transferFunction;
+  brickCount = {macrocells.getWidth(), macrocells.getHeight(), macrocells.getDepth()};
+  brickScale = macrocells.getScale();
+  const std::vector<uint8_t>& occupancy = macrocells.getOccupancy();
+  paddedOccupancy.resize(occupancy.size() + 3);
+  std::copy(occupancy.begin(), occupancy.end(), paddedOccupancy.begin());
+}
+
+size_t PacketRaycaster::supportedPacketSize() {
+#if defined(PACKET_KERNEL_X86) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  const int maxLeaf = info[0];
+  __cpuid(info, 1);
+  const bool sse41 = (info[2] & (1 << 19)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave || maxLeaf < 7) return sse41 ? 4 : 1;
+
+  // the operating system has to save the ymm and zmm registers
+  const unsigned long long xcr0 = _xgetbv(0);
+  __cpuidex(info, 7, 0);
+  if ((info[1] & (1 << 16)) && (xcr0 & 0xE6) == 0xE6) return 16;
+  if ((info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6) return 8;
+  return sse41 ? 4 : 1;
+#elif defined(PACKET_KERNEL_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return 16;
+  if (__builtin_cpu_supports("avx2")) return 8;
+  if (__builtin_cpu_supports("sse4.1")) return 4;
+  return 1;
+#else
+  return 1;
+#endif
+}
+
+void PacketRaycaster::setPacketSize(size_t packetSize) {
+  this->packetSize = 1;
+  for (size_t size : {4, 8, 16}) {
+    if (size <= packetSize && size <= supportedPacketSize()) this->packetSize = size;
+  }
+}
+
+Image PacketRaycaster::render(const Mat4& rotation, const Vec3& volumeExtend,
+                              const Vec3& minBounds, const Vec3& maxBounds,
+                              uint32_t width, uint32_t height,
+                              float oversampling, float viewExtent,
+                              const Vec3& background) const {
+  Image result{width, height, 3};
+
+  // step size and opacity correction as in the fragment shader
+  const Mat4 inverseRotation = Mat4::inverse(rotation);
+  const Vec3 direction = Vec3::normalize((inverseRotation * Vec4{0.0f,0.0f,-1.0f,0.0f}).xyz / volumeExtend);
+  const Vec3 voxels{float(voxelCount[0]), float(voxelCount[1]), float(voxelCount[2])};
+  const float samples = Vec3::dot(Vec3{std::fabs(direction.x), std::fabs(direction.y), std::fabs(direction.z)}, voxels);
+  const Vec3 delta = direction / (samples * oversampling);
+  const float opacityCorrection = 100.0f / (samples * oversampling);
+
+  std::vector<float> colorTable(4*TransferFunction::size);
+  for (size_t i = 0;i<TransferFunction::size;++i) {
+    const Vec4& c = transferFunction.lookup(uint8_t(i));
+    const float alpha = 1.0f - std::pow(1.0f - std::clamp(c.a, 0.0f, 1.0f), opacityCorrection);
+    colorTable[0*TransferFunction::size+i] = c.r * alpha;
+    colorTable[1*TransferFunction::size+i] = c.g * alpha;
+    colorTable[2*TransferFunction::size+i] = c.b * alpha;
+    colorTable[3*TransferFunction::size+i] = alpha;
+  }
+
+  const float aspect = float(width) / float(height);
+  auto toTexture = [&](float u, float v) -> Vec3 {
+    const Vec3 viewPos{((u+0.5f)/float(width)*2.0f-1.0f) * viewExtent * aspect,
+                       ((v+0.5f)/float(height)*2.0f-1.0f) * viewExtent, 0.0f};
+    return (inverseRotation * Vec4{viewPos, 1.0f}).xyz / volumeExtend + 0.5f;
+  };
+  const Vec3 origin = toTexture(0.0f, 0.0f);
+  const Vec3 stepU = toTexture(1.0f, 0.0f) - origin;
+  const Vec3 stepV = toTexture(0.0f, 1.0f) - origin;
+
+  PacketKernelParams params;
+  params.volume = paddedData.data();
+  params.sizeX = int32_t(voxelCount[0]);
+  params.sizeY = int32_t(voxelCount[1]);
+  params.sizeZ = int32_t(voxelCount[2]);
+  params.colorTable = colorTable.data();
+  params.occupancy = paddedOccupancy.data();
+  params.bricksX = int32_t(brickCount[0]);
+  params.bricksY = int32_t(brickCount[1]);
+  params.bricksZ = int32_t(brickCount[2]);
+  for (size_t a = 0;a<3;++a) {
+    params.origin[a] = origin.e[a];
+    params.stepU[a] = stepU.e[a];
+    params.stepV[a] = stepV.e[a];
+    params.delta[a] = delta.e[a];
+    params.brickScale[a] = brickScale.e[a];
+    params.minBounds[a] = minBounds.e[a];
+    params.maxBounds[a] = maxBounds.e[a];
+    params.background[a] = background.e[a];
+  }
+  params.compositing = int32_t(compositing);
+  params.width = width;
+  params.image = result.data.data();
+
+  void (*traceRow)(const PacketKernelParams&, uint32_t) = tracePacketRowScalar;
+#ifdef PACKET_KERNEL_X86
+  switch (packetSize) {
+    case 4  : traceRow = tracePacketRowSSE; break;
+    case 8  : traceRow = tracePacketRowAVX2; break;
+    case 16 : traceRow = tracePacketRowAVX512; break;
+  }
+#endif
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t row = 0;row<int64_t(height);++row) {
+    traceRow(params, uint32_t(row));
+  }
+
+  return result;
+}
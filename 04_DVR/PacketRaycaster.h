@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Image.h>
+#include <Mat4.h>
+
+#include <Volume.h>
+#include "TransferFunction.h"
+#include "Compositing.h"
+#include "MacrocellGrid.h"
+
+// CPU raycaster that traces packets of 4, 8 or 16 neighboring rays of a
+// parallel projection together (SSE4.1, AVX2 or AVX-512), with a scalar
+// fallback. The widest packet size supported by the processor is selected
+// at runtime, samples and opacity correction follow the GLSL raycaster.
+// Emission-absorption rays leap over the empty bricks of a macrocell grid
+// that was built from the same volume and classified with the same
+// transfer function.
+class PacketRaycaster {
+public:
+  PacketRaycaster();
+
+  void build(const Volume& volume);
+  void classify(const TransferFunction& transferFunction, const MacrocellGrid& macrocells);
+
+  static size_t supportedPacketSize();
+  // selects the widest supported packet size not larger than packetSize
+  void setPacketSize(size_t packetSize);
+  size_t getPacketSize() const {return packetSize;}
+
+  void setCompositing(Compositing compositing) {this->compositing = compositing;}
+  Compositing getCompositing() const {return compositing;}
+
+  Image render(const Mat4& rotation, const Vec3& volumeExtend,
+               const Vec3& minBounds, const Vec3& maxBounds,
+               uint32_t width, uint32_t height,
+               float oversampling=2.0f, float viewExtent=0.9f,
+               const Vec3& background=Vec3{0.0f,0.0f,0.5f}) const;
+
+private:
+  std::array<size_t,3> voxelCount;
+  std::vector<uint8_t> paddedData;
+  std::array<size_t,3> brickCount;
+  Vec3 brickScale;
+  std::vector<uint8_t> paddedOccupancy;
+  TransferFunction transferFunction;
+  size_t packetSize;
+  Compositing compositing;
+};
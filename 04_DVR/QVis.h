@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Volume.h"
+#include <Volume.h>
 
 class QVisFileException : std::exception {
 public:
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ResolutionController.h"
+
+ResolutionController::ResolutionController(double targetFrameTime, float minScale,
+                                           double refineDelay) :
+  targetFrameTime(targetFrameTime),
+  minScale(minScale),
+  refineDelay(refineDelay),
+  scale(1.0f),
+  interactiveScale(0.5f),
+  dirty(true),
+  rendered(false),
+  lastFrame(Clock::now()),
+  lastInteraction(Clock::now() - std::chrono::hours(1))
+{
+}
+
+void ResolutionController::interact() {
+  lastInteraction = Clock::now();
+  dirty = true;
+}
+
+bool ResolutionController::update() {
+  const Clock::time_point now = Clock::now();
+  const double frameTime = secondsSince(lastFrame, now);
+  lastFrame = now;
+
+  if (secondsSince(lastInteraction, now) < refineDelay) {
+    // the pixel count grows quadratically with the scale, frames that only
+    // presented the cached image say nothing about the raycasting cost
+    if (rendered && frameTime > 0.0) {
+      const float correction = float(std::sqrt(targetFrameTime / frameTime));
+      interactiveScale = std::clamp(interactiveScale * std::clamp(correction, 0.5f, 1.25f),
+                                    minScale, 1.0f);
+    }
+    scale = interactiveScale;
+    dirty = false;
+    rendered = true;
+  } else if (scale < 1.0f) {
+    scale = std::min(1.0f, scale * 2.0f);
+    rendered = true;
+  } else {
+    rendered = dirty;
+    dirty = false;
+  }
+  return rendered;
+}
+
+double ResolutionController::secondsSince(const Clock::time_point& t,
+                                          const Clock::time_point& now) const {
+  return std::chrono::duration<double>(now - t).count();
+}
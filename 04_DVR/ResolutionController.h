@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+// Chooses the render resolution of the raycaster per frame. While the user
+// interacts, the resolution scale is adapted so that the frame time stays
+// within the budget, once the interaction stops the image is refined in
+// steps up to full resolution. A still image is only rendered once.
+class ResolutionController {
+public:
+  ResolutionController(double targetFrameTime=1.0/30.0, float minScale=0.125f,
+                       double refineDelay=0.2);
+
+  void interact();
+  bool update();
+
+  float getScale() const {return scale;}
+
+private:
+  typedef std::chrono::high_resolution_clock Clock;
+
+  double targetFrameTime;
+  float minScale;
+  double refineDelay;
+
+  float scale;
+  float interactiveScale;
+  bool dirty;
+  bool rendered;
+  Clock::time_point lastFrame;
+  Clock::time_point lastInteraction;
+
+  double secondsSince(const Clock::time_point& t, const Clock::time_point& now) const;
+};
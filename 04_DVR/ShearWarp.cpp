@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <cmath>
+
+#include "ShearWarp.h"
+
+static const float terminationOpacity = 0.99f;
+
+ShearWarp::ShearWarp() :
+  voxelCount{0, 0, 0}
+{
+}
+
+void ShearWarp::build(const Volume& volume, const TransferFunction& transferFunction) {
+  voxelCount = {volume.width, volume.height, volume.depth};
+
+  // stack k slices the volume along axis k, its scanlines run along the
+  // next axis in cyclic order so that every stack stores them contiguously
+  for (size_t k = 0;k<3;++k) {
+    SliceStack& stack = stacks[k];
+    stack.axes = {(k+1)%3, (k+2)%3, k};
+    stack.width  = voxelCount[stack.axes[0]];
+    stack.height = voxelCount[stack.axes[1]];
+    stack.depth  = voxelCount[stack.axes[2]];
+    stack.data.resize(volume.data.size());
+
+    const std::array<size_t,3> stride{1, volume.width, volume.width*volume.height};
+    const size_t strideI = stride[stack.axes[0]];
+    const size_t strideJ = stride[stack.axes[1]];
+    const size_t strideK = stride[stack.axes[2]];
+
+    #pragma omp parallel for
+    for (int64_t w = 0;w<int64_t(stack.depth);++w) {
+      uint8_t* target = stack.data.data() + size_t(w) * stack.width * stack.height;
+      for (size_t v = 0;v<stack.height;++v) {
+        const uint8_t* source = volume.data.data() + size_t(w) * strideK + v * strideJ;
+        for (size_t u = 0;u<stack.width;++u) {
+          *target++ = source[u * strideI];
+        }
+      }
+    }
+  }
+
+  classify(transferFunction);
+}
+
+void ShearWarp::clear() {
+  voxelCount = {0, 0, 0};
+  for (SliceStack& stack : stacks) {
+    stack = SliceStack{};
+  }
+}
+
+void ShearWarp::classify(const TransferFunction& transferFunction) {
+  this->transferFunction = transferFunction;
+  const std::array<float, TransferFunction::size> opacity = transferFunction.getOpacity();
+  for (SliceStack& stack : stacks) {
+    encodeRuns(stack, opacity);
+  }
+}
+
+void ShearWarp::encodeRuns(SliceStack& stack, const std::array<float, TransferFunction::size>& opacity) {
+  const size_t scanlineCount = stack.height * stack.depth;
+  stack.runOffsets.resize(scanlineCount+1);
+
+  // first pass counts the runs per scanline, so the second pass can write
+  // them in parallel to their final position
+  #pragma omp parallel for
+  for (int64_t s = 0;s<int64_t(scanlineCount);++s) {
+    const uint8_t* scanline = stack.data.data() + size_t(s) * stack.width;
+    uint32_t count = 0;
+    bool inside = false;
+    for (size_t u = 0;u<stack.width;++u) {
+      const bool visible = opacity[scanline[u]] > 0.0f;
+      if (visible && !inside) ++count;
+      inside = visible;
+    }
+    stack.runOffsets[size_t(s)+1] = count;
+  }
+
+  stack.runOffsets[0] = 0;
+  for (size_t s = 0;s<scanlineCount;++s) {
+    stack.runOffsets[s+1] += stack.runOffsets[s];
+  }
+  stack.runs.resize(stack.runOffsets[scanlineCount]);
+
+  #pragma omp parallel for
+  for (int64_t s = 0;s<int64_t(scanlineCount);++s) {
+    const uint8_t* scanline = stack.data.data() + size_t(s) * stack.width;
+    Run* run = stack.runs.data() + stack.runOffsets[size_t(s)];
+    size_t u = 0;
+    while (u < stack.width) {
+      while (u < stack.width && opacity[scanline[u]] <= 0.0f) ++u;
+      if (u == stack.width) break;
+      run->start = uint16_t(u);
+      while (u < stack.width && opacity[scanline[u]] > 0.0f) ++u;
+      run->end = uint16_t(u);
+      ++run;
+    }
+  }
+}
+
+Image ShearWarp::render(const Mat4& rotation, const Vec3& volumeExtend,
+                        const Vec3& minBounds, const Vec3& maxBounds,
+                        uint32_t width, uint32_t height,
+                        float viewExtent, const Vec3& background) const {
+  Image result{width, height, 3};
+
+  // viewing direction in voxel coordinates selects the slice stack
+  const Mat4 inverseRotation = Mat4::inverse(rotation);
+  const Vec3 textureDirection = (inverseRotation * Vec4{0.0f,0.0f,-1.0f,0.0f}).xyz / volumeExtend;
+  const Vec3 voxelDirection = textureDirection * Vec3{float(voxelCount[0]),
+                                                      float(voxelCount[1]),
+                                                      float(voxelCount[2])};
+  size_t principal = 0;
+  for (size_t i = 1;i<3;++i) {
+    if (std::fabs(voxelDirection.e[i]) > std::fabs(voxelDirection.e[principal])) principal = i;
+  }
+  const SliceStack& stack = stacks[principal];
+  const float dk = voxelDirection.e[stack.axes[2]];
+  const float shearI = -voxelDirection.e[stack.axes[0]] / dk;
+  const float shearJ = -voxelDirection.e[stack.axes[1]] / dk;
+
+  // opacity correction for the distance between two slices along the ray,
+  // matching the correction of the GLSL raycaster
+  const float stepLength = textureDirection.length() /
+                           (std::fabs(textureDirection.e[principal]) * float(voxelCount[principal]));
+  const float opacityCorrection = 100.0f * stepLength;
+  std::array<Vec4, TransferFunction::size> colors;
+  for (size_t i = 0;i<colors.size();++i) {
+    const Vec4& c = transferFunction.lookup(uint8_t(i));
+    const float alpha = 1.0f - std::pow(1.0f - std::clamp(c.a, 0.0f, 1.0f), opacityCorrection);
+    colors[i] = Vec4{c.xyz * alpha, alpha};
+  }
+
+  // clip box as inclusive voxel ranges along i, j and k
+  std::array<int64_t,3> lo, hi;
+  for (size_t a = 0;a<3;++a) {
+    const size_t axis = stack.axes[a];
+    const float n = float(voxelCount[axis]);
+    lo[a] = std::max<int64_t>(0, int64_t(std::ceil(minBounds.e[axis] * n - 0.5f)));
+    hi[a] = std::min<int64_t>(int64_t(voxelCount[axis])-1, int64_t(std::floor(maxBounds.e[axis] * n - 0.5f)));
+  }
+
+  const float offsetI = shearI < 0.0f ? -shearI * float(stack.depth-1) : 0.0f;
+  const float offsetJ = shearJ < 0.0f ? -shearJ * float(stack.depth-1) : 0.0f;
+  const int64_t intermediateWidth  = int64_t(stack.width)  + int64_t(std::ceil(std::fabs(shearI) * float(stack.depth-1))) + 1;
+  const int64_t intermediateHeight = int64_t(stack.height) + int64_t(std::ceil(std::fabs(shearJ) * float(stack.depth-1))) + 1;
+  std::vector<Vec4> intermediate(size_t(intermediateWidth * intermediateHeight));
+
+  const bool empty = lo[0] > hi[0] || lo[1] > hi[1] || lo[2] > hi[2];
+
+  // every intermediate scanline composites all slices front to back
+  // independently of the others
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t y = 0;y<(empty ? 0 : intermediateHeight);++y) {
+    Vec4* row = intermediate.data() + y * intermediateWidth;
+
+    for (int64_t n = 0;n<=hi[2]-lo[2];++n) {
+      const int64_t k = dk > 0.0f ? lo[2] + n : hi[2] - n;
+      const uint8_t* slice = stack.data.data() + size_t(k) * stack.width * stack.height;
+
+      const float sliceY = float(y) - (shearJ * float(k) + offsetJ);
+      const int64_t j0 = int64_t(std::floor(sliceY));
+      if (j0+1 < lo[1] || j0 > hi[1]) continue;
+      const float fj = sliceY - float(j0);
+
+      const float shiftX = shearI * float(k) + offsetI;
+      const float shiftFloor = std::floor(shiftX);
+      const float fraction = shiftX - shiftFloor;
+      const int64_t pixelOffset = int64_t(shiftFloor) + (fraction > 0.0f ? 1 : 0);
+      const float fi = fraction > 0.0f ? 1.0f - fraction : 0.0f;
+
+      auto sample = [&](int64_t i, int64_t j) -> Vec4 {
+        if (i < lo[0] || i > hi[0] || j < lo[1] || j > hi[1]) return Vec4{};
+        return colors[slice[size_t(i) + size_t(j) * stack.width]];
+      };
+
+      auto composite = [&](int64_t first, int64_t last) {
+        // column lo[0]-1 only receives voxel lo[0] with weight fi
+        first = std::max(first, fi > 0.0f ? lo[0]-1 : lo[0]);
+        last = std::min(last, hi[0]);
+        for (int64_t i0 = first;i0<=last;++i0) {
+          Vec4& pixel = row[i0 + pixelOffset];
+          if (pixel.a >= terminationOpacity) continue;
+          const Vec4 c = (sample(i0,   j0  ) * (1.0f-fi) + sample(i0+1, j0  ) * fi) * (1.0f-fj) +
+                         (sample(i0,   j0+1) * (1.0f-fi) + sample(i0+1, j0+1) * fi) * fj;
+          pixel = pixel + c * (1.0f - pixel.a);
+        }
+      };
+
+      // merge the non-transparent runs of both contributing scanlines, a
+      // pixel is affected if one of its two voxel columns is inside a run
+      const Run* runsA = nullptr;
+      const Run* endA = nullptr;
+      const Run* runsB = nullptr;
+      const Run* endB = nullptr;
+      if (j0 >= lo[1]) {
+        const size_t s = size_t(j0) + size_t(k) * stack.height;
+        runsA = stack.runs.data() + stack.runOffsets[s];
+        endA  = stack.runs.data() + stack.runOffsets[s+1];
+      }
+      if (j0+1 <= hi[1]) {
+        const size_t s = size_t(j0+1) + size_t(k) * stack.height;
+        runsB = stack.runs.data() + stack.runOffsets[s];
+        endB  = stack.runs.data() + stack.runOffsets[s+1];
+      }
+
+      bool pending = false;
+      int64_t first = 0;
+      int64_t last = 0;
+      while (runsA != endA || runsB != endB) {
+        const Run* run = (runsB == endB || (runsA != endA && runsA->start <= runsB->start)) ?
+                         runsA++ : runsB++;
+        const int64_t runFirst = int64_t(run->start) - 1;
+        const int64_t runLast  = int64_t(run->end) - 1;
+        if (pending && runFirst <= last + 1) {
+          last = std::max(last, runLast);
+        } else {
+          if (pending) composite(first, last);
+          first = runFirst;
+          last = runLast;
+          pending = true;
+        }
+      }
+      if (pending) composite(first, last);
+    }
+  }
+
+  // warp the intermediate image into the final view, the mapping from final
+  // pixels to intermediate pixels is affine
+  const float aspect = float(width) / float(height);
+  auto toIntermediate = [&](float u, float v) -> Vec2 {
+    const Vec3 viewPos{((u+0.5f)/float(width)*2.0f-1.0f) * viewExtent * aspect,
+                       ((v+0.5f)/float(height)*2.0f-1.0f) * viewExtent, 0.0f};
+    const Vec3 texture = (inverseRotation * Vec4{viewPos, 1.0f}).xyz / volumeExtend + 0.5f;
+    const Vec3 voxel = texture * Vec3{float(voxelCount[0]), float(voxelCount[1]), float(voxelCount[2])} - 0.5f;
+    const float k = voxel.e[stack.axes[2]];
+    return Vec2{voxel.e[stack.axes[0]] + shearI * k + offsetI,
+                voxel.e[stack.axes[1]] + shearJ * k + offsetJ};
+  };
+  const Vec2 origin = toIntermediate(0.0f, 0.0f);
+  const Vec2 stepU = toIntermediate(1.0f, 0.0f) - origin;
+  const Vec2 stepV = toIntermediate(0.0f, 1.0f) - origin;
+
+  auto fetch = [&](int64_t x, int64_t y) -> Vec4 {
+    if (x < 0 || y < 0 || x >= intermediateWidth || y >= intermediateHeight) return Vec4{};
+    return intermediate[size_t(x + y * intermediateWidth)];
+  };
+
+  #pragma omp parallel for
+  for (int64_t v = 0;v<int64_t(height);++v) {
+    for (uint32_t u = 0;u<width;++u) {
+      const Vec2 p = origin + stepU * float(u) + stepV * float(v);
+      const int64_t x0 = int64_t(std::floor(p.x));
+      const int64_t y0 = int64_t(std::floor(p.y));
+      const float fx = p.x - float(x0);
+      const float fy = p.y - float(y0);
+      const Vec4 c = (fetch(x0, y0  ) * (1.0f-fx) + fetch(x0+1, y0  ) * fx) * (1.0f-fy) +
+                     (fetch(x0, y0+1) * (1.0f-fx) + fetch(x0+1, y0+1) * fx) * fy;
+      const Vec3 color = c.xyz + background * (1.0f - c.a);
+      for (uint8_t i = 0;i<3;++i) {
+        result.setValue(u, uint32_t(v), i, uint8_t(std::clamp(color.e[i], 0.0f, 1.0f) * 255.0f));
+      }
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Image.h>
+#include <Mat4.h>
+
+#include <Volume.h>
+#include "TransferFunction.h"
+
+// CPU volume renderer based on the shear-warp factorization for parallel
+// projections. The volume is kept as three slice stacks, one per principal
+// axis, whose scanlines are run-length encoded into transparent and
+// non-transparent runs. Rendering composites the sheared slices of the
+// stack most perpendicular to the viewing direction into an intermediate
+// image, one intermediate scanline per task, and warps that image into the
+// final view. The stacks triple the memory of the volume, so build them
+// only when needed and clear them once the volume changes.
+class ShearWarp {
+public:
+  ShearWarp();
+
+  void build(const Volume& volume, const TransferFunction& transferFunction);
+  void classify(const TransferFunction& transferFunction);
+  void clear();
+
+  bool isEmpty() const {return stacks[0].data.empty();}
+
+  Image render(const Mat4& rotation, const Vec3& volumeExtend,
+               const Vec3& minBounds, const Vec3& maxBounds,
+               uint32_t width, uint32_t height,
+               float viewExtent=0.9f,
+               const Vec3& background=Vec3{0.0f,0.0f,0.5f}) const;
+
+private:
+  struct Run {
+    uint16_t start;
+    uint16_t end;
+  };
+
+  struct SliceStack {
+    std::array<size_t,3> axes;
+    size_t width;
+    size_t height;
+    size_t depth;
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> runOffsets;
+    std::vector<Run> runs;
+  };
+
+  std::array<size_t,3> voxelCount;
+  std::array<SliceStack,3> stacks;
+  TransferFunction transferFunction;
+
+  void encodeRuns(SliceStack& stack, const std::array<float, TransferFunction::size>& opacity);
+};
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TransferFunction.h"
+
+TransferFunction::TransferFunction(float smoothStepStart, float smoothStepWidth) {
+  setSmoothStep(smoothStepStart, smoothStepWidth);
+}
+
+void TransferFunction::setSmoothStep(float smoothStepStart, float smoothStepWidth) {
+  this->smoothStepStart = smoothStepStart;
+  this->smoothStepWidth = smoothStepWidth;
+
+  for (size_t i = 0;i<size;++i) {
+    float v = std::clamp((float(i)/float(size-1) - smoothStepStart) / smoothStepWidth, 0.0f, 1.0f);
+    v = v*v * (3-2*v);
+    table[i] = Vec4{v,v,v,v};
+  }
+}
+
+Vec4 TransferFunction::evaluate(float value) const {
+  const float pos = std::clamp(value, 0.0f, 1.0f) * float(size-1);
+  const size_t index = std::min(size_t(pos), size-2);
+  const float alpha = pos - float(index);
+  return table[index] * (1.0f - alpha) + table[index+1] * alpha;
+}
+
+std::array<float, TransferFunction::size> TransferFunction::getOpacity() const {
+  std::array<float, size> opacity;
+  for (size_t i = 0;i<size;++i) {
+    opacity[i] = table[i].a;
+  }
+  return opacity;
+}
+
+std::vector<uint8_t> TransferFunction::toByteArray() const {
+  std::vector<uint8_t> data(size*4);
+  for (size_t i = 0;i<size;++i) {
+    for (size_t c = 0;c<4;++c) {
+      data[i*4+c] = uint8_t(std::clamp(table[i].e[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+  }
+  return data;
+}
+
+std::vector<float> TransferFunction::computePreintegrationTable() const {
+  // extinction per entry, for a segment in which the transfer function is
+  // constant the integral reproduces the table opacity
+  std::array<float, size> extinction;
+  for (size_t i = 0;i<size;++i) {
+    extinction[i] = -std::log(1.0f - std::min(table[i].a, 0.999f));
+  }
+
+  std::vector<float> result(size*size*4);
+
+  // one row per back value, the scalar varies linearly from front to back
+  // along the segment and each table entry in between is visited once
+  #pragma omp parallel for
+  for (int64_t back = 0;back<int64_t(size);++back) {
+    for (size_t front = 0;front<size;++front) {
+      const size_t steps = size_t(std::abs(int64_t(back)-int64_t(front))) + 1;
+      const float stepSize = 1.0f / float(steps);
+
+      Vec4 accumulated;
+      for (size_t s = 0;s<steps;++s) {
+        const float pos = float(front) + (float(back)-float(front)) * (float(s)+0.5f) * stepSize;
+        const size_t index = std::min(size_t(pos), size-2);
+        const float alpha = pos - float(index);
+
+        const float tau = extinction[index] * (1.0f - alpha) + extinction[index+1] * alpha;
+        const float sampleOpacity = 1.0f - std::exp(-tau * stepSize);
+        const Vec4 color = table[index] * (1.0f - alpha) + table[index+1] * alpha;
+
+        accumulated = accumulated + Vec4{color.xyz * ((1.0f - accumulated.a) * sampleOpacity),
+                                         (1.0f - accumulated.a) * sampleOpacity};
+      }
+
+      const size_t index = (front + size_t(back) * size) * 4;
+      result[index+0] = accumulated.r;
+      result[index+1] = accumulated.g;
+      result[index+2] = accumulated.b;
+      result[index+3] = accumulated.a;
+    }
+  }
+
+  return result;
+}
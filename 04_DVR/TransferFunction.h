@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Vec4.h>
+
+// Transfer function for 8 bit volumes stored as a 256 entry RGBA lookup
+// table. Besides the plain table for post-classification it computes the
+// 256x256 pre-integration table, indexed by the scalar values at the front
+// and the back of a ray segment.
+class TransferFunction {
+public:
+  static const size_t size = 256;
+
+  TransferFunction(float smoothStepStart=0.12f, float smoothStepWidth=0.1f);
+
+  void setSmoothStep(float smoothStepStart, float smoothStepWidth);
+  float getSmoothStepStart() const {return smoothStepStart;}
+  float getSmoothStepWidth() const {return smoothStepWidth;}
+
+  const Vec4& lookup(uint8_t value) const {return table[value];}
+  Vec4 evaluate(float value) const;
+  std::array<float, size> getOpacity() const;
+
+  std::vector<uint8_t> toByteArray() const;
+  std::vector<float> computePreintegrationTable() const;
+
+private:
+  float smoothStepStart;
+  float smoothStepWidth;
+  std::array<Vec4, size> table;
+};
@@ -0,0 +1,132 @@
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#include "AsyncImageWriter.h"
+#include "PacketRaycaster.h"
+#include "QVis.h"
+#include "Turntable.h"
+
+static std::string nextArgument(int argc, char** argv, int& i) {
+  if (i+1 >= argc)
+    throw TurntableException(std::string("Missing value for ") + argv[i]);
+  return argv[++i];
+}
+
+template <typename T>
+static T parseNumber(const std::string& text) {
+  std::istringstream stream(text);
+  T value;
+  if (!(stream >> value) || !stream.eof())
+    throw TurntableException("Invalid number " + text);
+  return value;
+}
+
+TurntableSettings TurntableSettings::fromArguments(int argc, char** argv) {
+  TurntableSettings settings;
+  if (argc < 3) throw TurntableException("Missing dataset");
+  settings.dataset = argv[2];
+
+  for (int i = 3;i<argc;++i) {
+    const std::string option = argv[i];
+    if (option == "--frames") {
+      settings.frameCount = parseNumber<size_t>(nextArgument(argc, argv, i));
+    } else if (option == "--elevation") {
+      settings.elevation = parseNumber<float>(nextArgument(argc, argv, i));
+    } else if (option == "--size") {
+      const std::string size = nextArgument(argc, argv, i);
+      const size_t separator = size.find('x');
+      if (separator == std::string::npos)
+        throw TurntableException("Invalid size " + size);
+      settings.width = parseNumber<uint32_t>(size.substr(0, separator));
+      settings.height = parseNumber<uint32_t>(size.substr(separator+1));
+    } else if (option == "--transfer") {
+      settings.smoothStepStart = parseNumber<float>(nextArgument(argc, argv, i));
+      settings.smoothStepWidth = parseNumber<float>(nextArgument(argc, argv, i));
+    } else if (option == "--oversampling") {
+      settings.oversampling = parseNumber<float>(nextArgument(argc, argv, i));
+    } else if (option == "--output") {
+      settings.outputPattern = nextArgument(argc, argv, i);
+    } else if (option == "--gpu") {
+      settings.gpu = true;
+    } else {
+      throw TurntableException("Unknown option " + option);
+    }
+  }
+
+  if (settings.frameCount == 0 || settings.width == 0 || settings.height == 0)
+    throw TurntableException("Frame count and image size must not be zero");
+  if (settings.oversampling <= 0.0f || settings.smoothStepWidth <= 0.0f)
+    throw TurntableException("Oversampling and transfer function width must be positive");
+  return settings;
+}
+
+std::string TurntableSettings::usage() {
+  return "Usage: Raycaster --turntable dataset.dat [--frames N] [--elevation degrees]\n"
+         "                 [--size WIDTHxHEIGHT] [--transfer start width]\n"
+         "                 [--oversampling factor] [--output turntable_####.bmp] [--gpu]\n";
+}
+
+Mat4 TurntableSettings::frameRotation(size_t frame) const {
+  return Mat4::rotationX(elevation) * Mat4::rotationY(360.0f * float(frame) / float(frameCount));
+}
+
+std::string TurntableSettings::frameFilename(size_t frame) const {
+  std::string filename;
+  for (size_t i = 0;i<outputPattern.size();) {
+    if (outputPattern[i] != '#') {
+      filename += outputPattern[i++];
+      continue;
+    }
+    size_t digits = 0;
+    while (i < outputPattern.size() && outputPattern[i] == '#') {
+      ++digits;
+      ++i;
+    }
+    const std::string number = std::to_string(frame);
+    if (number.size() < digits) filename += std::string(digits - number.size(), '0');
+    filename += number;
+  }
+  return filename;
+}
+
+double Turntable::renderCPU(const TurntableSettings& settings) {
+  const Volume volume = QVis{settings.dataset}.volume;
+  const Vec3 volumeExtend = volume.scale *
+    Vec3{float(volume.width),float(volume.height),float(volume.depth)} / float(volume.maxSize);
+
+  const TransferFunction transferFunction{settings.smoothStepStart, settings.smoothStepWidth};
+  MacrocellGrid macrocells;
+  macrocells.build(volume);
+  macrocells.classify(transferFunction.getOpacity());
+  PacketRaycaster raycaster;
+  raycaster.build(volume);
+  raycaster.classify(transferFunction, macrocells);
+
+  // same field of view as the interactive raycaster at the default zoom
+  const float viewExtent = std::tan(22.5f * 3.14159265f / 180.0f) * 2.0f;
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  AsyncImageWriter writer;
+
+  // one frame per thread, the row loop inside render stays serial as
+  // nested parallelism is disabled
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t frame = 0;frame<int64_t(settings.frameCount);++frame) {
+    Image image = raycaster.render(settings.frameRotation(size_t(frame)), volumeExtend,
+                                   Vec3{0.0f,0.0f,0.0f}, Vec3{1.0f,1.0f,1.0f},
+                                   settings.width, settings.height,
+                                   settings.oversampling, viewExtent);
+    writer.push(settings.frameFilename(size_t(frame)), std::move(image));
+  }
+  writer.finish();
+
+  const std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+  const double fps = double(settings.frameCount) / duration.count();
+  std::cout << writer.getWrittenCount() << " frames written in " << duration.count() << " s ("
+            << fps << " fps, " << raycaster.getPacketSize() << " rays per packet)" << std::endl;
+  if (writer.getFailedCount() > 0)
+    std::cerr << writer.getFailedCount() << " frames could not be written" << std::endl;
+  return fps;
+}
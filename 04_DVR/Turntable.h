@@ -0,0 +1,46 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+#include <Mat4.h>
+
+class TurntableException : public std::exception {
+public:
+  TurntableException(const std::string& whatStr) : whatStr(whatStr) {}
+  virtual const char* what() const throw() {
+    return whatStr.c_str();
+  }
+private:
+  std::string whatStr;
+};
+
+// Settings of a headless turntable render: the volume is orbited once
+// around its vertical axis in frameCount steps, seen from elevation degrees
+// above the equator. Every '#' run in outputPattern is replaced by the zero
+// padded frame number.
+struct TurntableSettings {
+  std::string dataset{"c60.dat"};
+  size_t frameCount{36};
+  float elevation{20.0f};
+  uint32_t width{512};
+  uint32_t height{512};
+  float smoothStepStart{0.12f};
+  float smoothStepWidth{0.1f};
+  float oversampling{2.0f};
+  std::string outputPattern{"turntable_####.bmp"};
+  bool gpu{false};
+
+  static TurntableSettings fromArguments(int argc, char** argv);
+  static std::string usage();
+
+  Mat4 frameRotation(size_t frame) const;
+  std::string frameFilename(size_t frame) const;
+};
+
+class Turntable {
+public:
+  // renders the frames in parallel with the packet raycaster, returns the
+  // throughput in frames per second
+  static double renderCPU(const TurntableSettings& settings);
+};
@@ -4,18 +4,63 @@ in vec3 entryPoint;
 out vec4 result;
 
 uniform sampler3D volume;
+uniform sampler3D macrocells;
+uniform sampler1D transferFunction;
+uniform sampler2D preintegrationTable;
+uniform sampler3D gradients;
+uniform sampler3D brickRanges;
 
-uniform float smoothStepStart;
-uniform float smoothStepWidth;
+uniform int preintegration;
+uniform int shading;          // 0: unlit, 1: precomputed gradients, 2: on-the-fly
+uniform int compositing;      // 0: emission-absorption, 1: maximum, 2: minimum, 3: average
 uniform float oversampling;
 uniform vec3 voxelCount;
 uniform vec3 cameraPosInTextureSpace;
 uniform vec3 minBounds;
 uniform vec3 maxBounds;
+uniform vec3 macrocellScale;
 
-vec4 transferFunction(float v) {
-  v = clamp((v - smoothStepStart) / (smoothStepWidth), 0.0, 1.0);
-  return vec4(v*v * (3-2*v));
+const float terminationOpacity = 0.99;
+const float ambient = 0.3;
+const float diffuse = 0.7;
+const float specular = 0.3;
+const float shininess = 32.0;
+
+// maps a normalized scalar to the texel centers of the 256 entry tables
+float tableCoord(float v) {
+  return (v*255.0+0.5)/256.0;
+}
+
+vec4 classify(float v, float opacityCorrection) {
+  vec4 current = texture(transferFunction, tableCoord(v));
+  current.a = 1.0-pow(1.0-current.a, opacityCorrection);
+  return current;
+}
+
+vec4 classifySegment(float front, float back, float opacityCorrection) {
+  // the table stores premultiplied colors for a unit segment length
+  vec4 segment = texture(preintegrationTable, vec2(tableCoord(front), tableCoord(back)));
+  if (segment.a <= 0.0) return vec4(0.0);
+  return vec4(segment.rgb/segment.a, 1.0-pow(1.0-segment.a, opacityCorrection));
+}
+
+// gradient direction in texture space, either decoded from the quantized
+// gradient texture or from central differences with six extra fetches
+vec3 gradient(vec3 pos) {
+  if (shading == 1) return texture(gradients, pos).rgb*(255.0/127.5) - 128.0/127.5;
+  vec3 d = 1.0/voxelCount;
+  return vec3(texture(volume, pos+vec3(d.x,0,0)).r - texture(volume, pos-vec3(d.x,0,0)).r,
+              texture(volume, pos+vec3(0,d.y,0)).r - texture(volume, pos-vec3(0,d.y,0)).r,
+              texture(volume, pos+vec3(0,0,d.z)).r - texture(volume, pos-vec3(0,0,d.z)).r);
+}
+
+// two-sided Blinn-Phong with a headlight, homogeneous regions stay unlit
+vec3 shade(vec3 color, vec3 pos, vec3 viewDir) {
+  vec3 g = gradient(pos);
+  float len = length(g);
+  if (len < 0.001) return color;
+  float nDotV = abs(dot(g/len, viewDir));
+  return color*(ambient + diffuse*nDotV) + specular*pow(nDotV, shininess);
 }
 
 vec4 under(vec4 current, vec4 last) {
@@ -29,6 +74,40 @@ bool inBounds(vec3 pos) {
          pos.x <= maxBounds.x && pos.y <= maxBounds.y && pos.z <= maxBounds.z;
 }
 
+// maximum, minimum or average of the samples along the ray, bricks whose
+// value range cannot change the running maximum or minimum are skipped
+vec4 project(vec3 currentPoint, vec3 delta) {
+  ivec3 lastMacrocell = textureSize(brickRanges, 0)-1;
+  vec3 macrocellDelta = delta*macrocellScale;
+  float value = (compositing == 2) ? 1.0 : 0.0;
+  float count = 0.0;
+  do {
+    vec3 macrocellPos = currentPoint*macrocellScale;
+    vec2 range = texelFetch(brickRanges, min(ivec3(macrocellPos), lastMacrocell), 0).rg;
+    if ((compositing == 1 && range.y <= value) || (compositing == 2 && range.x >= value)) {
+      vec3 exitPlane = mix(floor(macrocellPos), floor(macrocellPos)+1.0, step(0.0, macrocellDelta));
+      vec3 exitSteps = (exitPlane-macrocellPos)/macrocellDelta;
+      float skip = min(exitSteps.x, min(exitSteps.y, exitSteps.z));
+      currentPoint += delta*max(1.0, ceil(skip));
+      continue;
+    }
+
+    float current = texture(volume,currentPoint).r;
+    if (compositing == 1) value = max(value, current);
+    else if (compositing == 2) value = min(value, current);
+    else value += current;
+    count += 1.0;
+
+    // nothing can change a saturated maximum or minimum
+    if ((compositing == 1 && value >= 1.0) || (compositing == 2 && value <= 0.0)) break;
+
+    currentPoint += delta;
+  } while (inBounds(currentPoint));
+
+  if (compositing == 3 && count > 0.0) value /= count;
+  return vec4(vec3(value), 1.0);
+}
+
 void main() {
   // compute vector to camera in texture space  
   vec3 rayDirectionInTextureSpace = normalize(entryPoint-cameraPosInTextureSpace);
@@ -38,15 +117,41 @@ void main() {
   float opacityCorrection = 100/(samples*oversampling);
   vec3 delta = rayDirectionInTextureSpace/(samples*oversampling);
 
+  if (compositing != 0) {
+    result = project(entryPoint, delta);
+    return;
+  }
+
   vec3 currentPoint = entryPoint;
+  ivec3 lastMacrocell = textureSize(macrocells, 0)-1;
+  vec3 macrocellDelta = delta*macrocellScale;
   result = vec4(0.0);
+  float frontValue = texture(volume,currentPoint).r;
   do {
-    // TODO: Implement raycaster and store the result in "result".
-    //       The next two lines are placeholder code ensuring all
-    //       variables are utilized. This prevents exceptions from
-    //       the initial shader. These placeholder lines should be
-    //       replaced by the raycasting code.
-    result = 1+transferFunction(texture(volume,delta).r);
-    break;
+    // leap over macrocells that the transfer function maps to zero opacity,
+    // advancing by whole steps to keep the sampling positions unchanged
+    vec3 macrocellPos = currentPoint*macrocellScale;
+    if (texelFetch(macrocells, min(ivec3(macrocellPos), lastMacrocell), 0).r == 0.0) {
+      vec3 exitPlane = mix(floor(macrocellPos), floor(macrocellPos)+1.0, step(0.0, macrocellDelta));
+      vec3 exitSteps = (exitPlane-macrocellPos)/macrocellDelta;
+      float skip = min(exitSteps.x, min(exitSteps.y, exitSteps.z));
+      currentPoint += delta*max(1.0, ceil(skip));
+      frontValue = texture(volume,currentPoint).r;
+      continue;
+    }
+
+    float backValue = texture(volume,currentPoint+delta).r;
+    vec4 current = (preintegration != 0) ?
+                   classifySegment(frontValue, backValue, opacityCorrection) :
+                   classify(frontValue, opacityCorrection);
+    if (shading != 0 && current.a > 0.0)
+      current.rgb = shade(current.rgb, currentPoint, rayDirectionInTextureSpace);
+    result = under(current, result);
+
+    // early ray termination
+    if (result.a >= terminationOpacity) break;
+
+    frontValue = backValue;
+    currentPoint += delta;
   } while (inBounds(currentPoint));
 }
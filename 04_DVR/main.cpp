@@ -1,7 +1,25 @@
+#include <chrono>
+#include <memory>
+
 #include <GLApp.h>
 #include <Tesselation.h>
 #include <ArcBall.h>
+#include <GLFramebuffer.h>
+#include <GLTimerQuery.h>
+#include <bmp.h>
+#include <Flowfield.h>
+#include <VolumeLIC.h>
+#include <FlowDerivatives.h>
 #include "Clipper.h"
+#include "MacrocellGrid.h"
+#include "TransferFunction.h"
+#include "ResolutionController.h"
+#include "ShearWarp.h"
+#include "PacketRaycaster.h"
+#include "GradientVolume.h"
+#include "AsyncImageWriter.h"
+#include "Turntable.h"
+#include "AxisProjection.h"
 
 #include "QVis.h"
 
@@ -10,6 +28,18 @@ public:
     
   Raycaster() : GLApp(512, 512, 1, "Raycaster") {}
 
+  // renders the turntable frames into the offscreen framebuffer and quits
+  Raycaster(const TurntableSettings& turntable) :
+    GLApp(turntable.width, turntable.height, 1, "Raycaster (turntable)", false, false),
+    turntable{turntable},
+    turntableWriter{std::make_unique<AsyncImageWriter>()}
+  {
+    filenames = {turntable.dataset};
+    stepStart = turntable.smoothStepStart;
+    stepWidth = turntable.smoothStepWidth;
+    oversampling = turntable.oversampling;
+  }
+
   virtual void animate(double animationTime) override {
   }
 
@@ -23,6 +53,7 @@ public:
     modelViewProjection = projection * view * model * clipBox;
     viewToTexture = Mat4::translation({0.5f,0.5f,0.5f}) * Mat4::inverse(view * model);
     meshNeedsUpdte = true;
+    resolution.interact();
   }
 
   void clipCubeToNearplane() {
@@ -30,15 +61,41 @@ public:
     meshNeedsUpdte = false;
     // transpose( inverse( inverse(view*model) ) ) -> transpose(view*model)
     const Vec4 objectSpaceNearPlane{Mat4::transpose(view*model)*Vec4{0,0,1.0f,near+0.01f}};
-    std::vector<float> verts = Clipper::meshPlane(cube.getVertices(),
-                                                  objectSpaceNearPlane.xyz,
-                                                  objectSpaceNearPlane.w);
-    vertCount = verts.size()/3;
-    vbCube.setData(verts, 3);
+    std::copy(cube.getVertices().begin(), cube.getVertices().end(), clippedCube.begin());
+    vertCount = Clipper::meshPlane(clippedCube.data(), cube.getVertices().size()/3,
+                                   clippedCube.size()/3,
+                                   objectSpaceNearPlane.xyz, objectSpaceNearPlane.w);
+    vbCube.setData(clippedCube.data(), vertCount*3, 3);
   }
 
   void loadVolume() {
     volume = QVis{filenames[currentFile]}.volume;
+    setupVolume();
+  }
+
+  void computeFlowVolume() {
+    const auto start = std::chrono::high_resolution_clock::now();
+    VolumeLIC lic;
+    volume = lic.compute(Flowfield::genDemo(128, DemoType::SATTLE));
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
+    setupVolume();
+
+    std::stringstream ss;
+    ss << "Raycaster (volume LIC, " << lic.getNoiseVoxelCount() << " noise voxels, "
+       << lic.getStreamlineCount() << " streamlines, " << duration.count() << " ms)";
+    glEnv.setTitle(ss.str());
+  }
+
+  void computeDerivedVolume() {
+    if (!derivatives) derivatives = std::make_unique<FlowDerivatives>(Flowfield::genDemo(128, DemoType::CRITICAL));
+    volume = derivatives->toVolume(derivedQuantity);
+    setupVolume();
+    glEnv.setTitle("Raycaster (" + toString(derivedQuantity) + " of the demo flow)");
+    derivedQuantity = DerivedQuantity((int(derivedQuantity) + 1) % 4);
+  }
+
+  void setupVolume() {
     voxelCount = Vec3{float(volume.width),float(volume.height),float(volume.depth)};
     volumeExtend = volume.scale*voxelCount/float(volume.maxSize);
 
@@ -47,11 +104,82 @@ public:
                       uint32_t(volume.height),
                       uint32_t(volume.depth), 1);
 
+    macrocells.build(volume);
+    brickRangeTex.setData(macrocells.getRanges(),
+                          uint32_t(macrocells.getWidth()),
+                          uint32_t(macrocells.getHeight()),
+                          uint32_t(macrocells.getDepth()), 2);
+    gradientVolume.clear();
+    if (shading == 1) updateGradients();
+    shearWarp.clear();
+    packetRaycaster.build(volume);
+    updateTransferFunction();
+  }
+
+  void updateTransferFunction() {
+    transferFunction.setSmoothStep(stepStart, stepWidth);
+    transferFunctionTex.setData(transferFunction.toByteArray(),
+                                uint32_t(TransferFunction::size), 4);
+    preintegrationTex.setData(transferFunction.computePreintegrationTable(),
+                              uint32_t(TransferFunction::size),
+                              uint32_t(TransferFunction::size), 4);
+
+    macrocells.classify(transferFunction.getOpacity());
+    shearWarpClassified = false;
+    packetRaycaster.classify(transferFunction, macrocells);
+    resolution.interact();
+    const uint32_t bricks[3] = {uint32_t(macrocells.getWidth()),
+                                uint32_t(macrocells.getHeight()),
+                                uint32_t(macrocells.getDepth())};
+    // transfer function edits keep the grid size, stream those updates
+    if (macrocellTex.getWidth() == bricks[0] && macrocellTex.getHeight() == bricks[1] &&
+        macrocellTex.getDepth() == bricks[2])
+      macrocellTex.streamSubData(macrocells.getOccupancy(), 0, 0, 0, bricks[0], bricks[1], bricks[2]);
+    else
+      macrocellTex.setData(macrocells.getOccupancy(), bricks[0], bricks[1], bricks[2], 1);
+  }
+
+  void updateGradients() {
+    if (!gradientVolume.isEmpty()) return;
+    const auto start = std::chrono::high_resolution_clock::now();
+    gradientVolume.build(volume);
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
+    gradientBuildTime = duration.count();
+    gradientTex.setData(gradientVolume.getData(),
+                        uint32_t(gradientVolume.getWidth()),
+                        uint32_t(gradientVolume.getHeight()),
+                        uint32_t(gradientVolume.getDepth()), 3);
+  }
+
+  std::string shadingDescription() const {
+    std::stringstream ss;
+    switch (shading) {
+      case 0 :
+        ss << "unlit";
+        break;
+      case 1 :
+        ss << "precomputed gradients, "
+           << double(gradientVolume.getMemoryFootprint()) / (1024.0 * 1024.0) << " MB, built in "
+           << gradientBuildTime << " ms";
+        break;
+      case 2 :
+        ss << "on-the-fly gradients, 0 MB, 6 extra fetches per sample";
+        break;
+    }
+    return ss.str();
   }
 
   virtual void init() override {
+    // the volume and its derived data are kept on the CPU anyway
+    volumeTex.setShadowCopy(false);
+    gradientTex.setShadowCopy(false);
+    macrocellTex.setShadowCopy(false);
+    brickRangeTex.setShadowCopy(false);
     loadVolume();
 
+    // room for every triangle being split plus the cap of the cut
+    clippedCube.resize(cube.getVertices().size()*2 + Clipper::maxCapVertices*3*3);
     vertCount = cube.getVertices().size();
     cubeArray.bind();
     vbCube.setData(cube.getVertices(), 3);
@@ -59,10 +187,7 @@ public:
 
     GL(glClearColor(0,0,0.5,1));
     GL(glClearDepth(1.0f));
-    GL(glEnable(GL_DEPTH_TEST));
-    GL(glEnable(GL_CULL_FACE));
     GL(glCullFace(GL_BACK));
-    GL(glEnable(GL_BLEND));
     GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
     GL(glBlendEquation(GL_FUNC_ADD));
   }
@@ -73,16 +198,103 @@ public:
     arcball.setWindowSize({dim.width,dim.height});
 
     GL(glViewport(0, 0, GLsizei(width), GLsizei(height)));
+    renderTarget.setEmpty(uint32_t(width), uint32_t(height), 4);
+    renderDepth.setSize(uint32_t(width), uint32_t(height));
     updateMatrices();
   }
 
-  virtual void draw() override {
+  void renderTurntableFrame() {
+    if (turntableFrame == turntable.frameCount) return;
+    if (turntableFrame == 0) turntableStart = std::chrono::high_resolution_clock::now();
+
+    rotation = turntable.frameRotation(turntableFrame);
+    updateMatrices();
     clipCubeToNearplane();
+    framebuffer.bind(renderTarget, renderDepth);
+    raycast();
+    framebuffer.unbind2D();
+
+    const Image rgba = renderTarget.getImage();
+    Image rgb{rgba.width, rgba.height, 3};
+    for (size_t i = 0;i<size_t(rgba.width)*size_t(rgba.height);++i) {
+      for (size_t c = 0;c<3;++c) rgb.data[i*3+c] = rgba.data[i*4+c];
+    }
+    turntableWriter->push(turntable.frameFilename(turntableFrame), std::move(rgb));
+
+    const Dimensions dim = glEnv.getFramebufferSize();
+    GL(glViewport(0, 0, GLsizei(dim.width), GLsizei(dim.height)));
+    GL(glDisable(GL_DEPTH_TEST));
+    GL(glDisable(GL_CULL_FACE));
+    GL(glDisable(GL_BLEND));
+    drawImage(renderTarget, Vec2{-1.0f,-1.0f}, Vec2{1.0f,1.0f});
+
+    if (++turntableFrame == turntable.frameCount) {
+      turntableWriter->finish();
+      const std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - turntableStart;
+      std::cout << turntableWriter->getWrittenCount() << " frames written in " << duration.count()
+                << " s (" << double(turntable.frameCount) / duration.count() << " fps, GPU)" << std::endl;
+      closeWindow();
+    }
+  }
+
+  virtual void draw() override {
+    if (turntableWriter) {
+      renderTurntableFrame();
+      return;
+    }
+
+    // only raycast when the image changed or is still being refined,
+    // otherwise present the last image again
+    if (resolution.update()) {
+      clipCubeToNearplane();
 
+      renderWidth = std::max(1u, uint32_t(float(renderTarget.getWidth()) * resolution.getScale()));
+      renderHeight = std::max(1u, uint32_t(float(renderTarget.getHeight()) * resolution.getScale()));
+
+      framebuffer.bind(renderTarget, renderDepth);
+      GL(glViewport(0, 0, GLsizei(renderWidth), GLsizei(renderHeight)));
+      const bool timed = !raycastTimer.isPending();
+      if (timed) raycastTimer.begin();
+      raycast();
+      if (timed) raycastTimer.end();
+      framebuffer.unbind2D();
+    }
+
+    double raycastTime;
+    if (raycastTimer.poll(raycastTime) && shading != 0) {
+      std::stringstream ss;
+      ss << "Raycaster (" << shadingDescription() << ": " << raycastTime << " ms per frame)";
+      glEnv.setTitle(ss.str());
+    }
+
+    // upscale the rendered region of the target to the whole window
+    const Dimensions dim = glEnv.getFramebufferSize();
+    GL(glViewport(0, 0, GLsizei(dim.width), GLsizei(dim.height)));
+    GL(glDisable(GL_DEPTH_TEST));
+    GL(glDisable(GL_CULL_FACE));
+    GL(glDisable(GL_BLEND));
+    const Vec2 extend{2.0f * float(renderTarget.getWidth()) / float(renderWidth),
+                      2.0f * float(renderTarget.getHeight()) / float(renderHeight)};
+    drawImage(renderTarget, Vec2{-1.0f,-1.0f}, Vec2{-1.0f,-1.0f} + extend);
+  }
+
+  void raycast() {
+    GL(glEnable(GL_DEPTH_TEST));
+    GL(glEnable(GL_CULL_FACE));
+    GL(glEnable(GL_BLEND));
     GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
     cubeProgram.enable();
     cubeProgram.setTexture("volume",volumeTex,0);
+    cubeProgram.setTexture("macrocells",macrocellTex,1);
+    cubeProgram.setTexture("transferFunction",transferFunctionTex,2);
+    cubeProgram.setTexture("preintegrationTable",preintegrationTex,3);
+    cubeProgram.setTexture("gradients",gradientTex,4);
+    cubeProgram.setTexture("brickRanges",brickRangeTex,5);
+    cubeProgram.setUniform("preintegration", preintegration ? 1 : 0);
+    cubeProgram.setUniform("shading", shading);
+    cubeProgram.setUniform("compositing", int(compositing));
     cubeProgram.setUniform("modelViewProjection", modelViewProjection);
     cubeProgram.setUniform("clip", clipBox);
     cubeProgram.setUniform("minBounds", minBounds);
@@ -90,9 +302,8 @@ public:
     cubeProgram.setUniform("cameraPosInTextureSpace", (viewToTexture * Vec4{0,0,0,1}).xyz);
 
     cubeProgram.setUniform("voxelCount", voxelCount);
+    cubeProgram.setUniform("macrocellScale", macrocells.getScale());
     cubeProgram.setUniform("oversampling", oversampling);
-    cubeProgram.setUniform("smoothStepStart", stepStart);
-    cubeProgram.setUniform("smoothStepWidth", stepWidth);
 
     GL(glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertCount)));
   }
@@ -109,16 +320,94 @@ public:
           loadVolume();
           updateMatrices();
           break;
+        case GLENV_KEY_F:
+          computeFlowVolume();
+          updateMatrices();
+          break;
+        case GLENV_KEY_D:
+          computeDerivedVolume();
+          updateMatrices();
+          break;
         case GLENV_KEY_Q:
           oversampling *= 2;
+          resolution.interact();
           ss << "Raycaster (" << oversampling << " x oversampling)";
           glEnv.setTitle(ss.str());
           break;
         case GLENV_KEY_W:
           oversampling /= 2;
+          resolution.interact();
           ss << "Raycaster (" << oversampling << " x oversampling)";
           glEnv.setTitle(ss.str());
           break;
+        case GLENV_KEY_L:
+          shading = (shading + 1) % 3;
+          if (shading == 1) updateGradients();
+          resolution.interact();
+          ss << "Raycaster (" << shadingDescription() << ")";
+          glEnv.setTitle(ss.str());
+          break;
+        case GLENV_KEY_M:
+          compositing = Compositing((int(compositing) + 1) % 4);
+          packetRaycaster.setCompositing(compositing);
+          resolution.interact();
+          ss << "Raycaster (" << toString(compositing) << ")";
+          glEnv.setTitle(ss.str());
+          break;
+        case GLENV_KEY_X: {
+          // reduce along the volume axis closest to the viewing direction
+          const Vec3 direction = (Mat4::inverse(rotation) * Vec4{0.0f,0.0f,-1.0f,0.0f}).xyz;
+          size_t axis = 0;
+          for (size_t a = 1;a<3;++a) {
+            if (std::fabs(direction.e[a]) > std::fabs(direction.e[axis])) axis = a;
+          }
+          const Compositing mode = compositing == Compositing::EmissionAbsorption ?
+                                   Compositing::Maximum : compositing;
+          const auto start = std::chrono::high_resolution_clock::now();
+          const Image image = AxisProjection::compute(volume, macrocells, axis, mode);
+          const std::chrono::duration<double, std::milli> duration =
+            std::chrono::high_resolution_clock::now() - start;
+          BMP::save("projection.bmp", image);
+          ss << "Raycaster (" << toString(mode) << " along axis " << axis << ": "
+             << duration.count() << " ms, saved to projection.bmp)";
+          glEnv.setTitle(ss.str());
+          break;
+        }
+        case GLENV_KEY_P:
+          preintegration = !preintegration;
+          resolution.interact();
+          ss << "Raycaster (" << (preintegration ? "pre-integrated" : "post-classified") << ")";
+          glEnv.setTitle(ss.str());
+          break;
+        case GLENV_KEY_S: {
+          // parallel projection covering the frustum at the volume center
+          const Dimensions dim = glEnv.getFramebufferSize();
+          const float viewExtent = std::tan(22.5f * 3.14159265f / 180.0f) * (2.0f - zoom);
+          if (shearWarp.isEmpty()) {
+            shearWarp.build(volume, transferFunction);
+          } else if (!shearWarpClassified) {
+            shearWarp.classify(transferFunction);
+          }
+          shearWarpClassified = true;
+          BMP::save("shearwarp.bmp", shearWarp.render(rotation, volumeExtend, minBounds, maxBounds,
+                                                      dim.width, dim.height, viewExtent));
+          glEnv.setTitle("Raycaster (shear-warp image saved to shearwarp.bmp)");
+          break;
+        }
+        case GLENV_KEY_C: {
+          const Dimensions dim = glEnv.getFramebufferSize();
+          const float viewExtent = std::tan(22.5f * 3.14159265f / 180.0f) * (2.0f - zoom);
+          const auto start = std::chrono::high_resolution_clock::now();
+          const Image image = packetRaycaster.render(rotation, volumeExtend, minBounds, maxBounds,
+                                                     dim.width, dim.height, oversampling, viewExtent);
+          const std::chrono::duration<double, std::milli> duration =
+            std::chrono::high_resolution_clock::now() - start;
+          BMP::save("packetraycast.bmp", image);
+          ss << "Raycaster (CPU, " << packetRaycaster.getPacketSize() << " rays per packet: "
+             << duration.count() << " ms, saved to packetraycast.bmp)";
+          glEnv.setTitle(ss.str());
+          break;
+        }
         case GLENV_KEY_R:
           rotation = Mat4{};
           stepStart = 0.12f;
@@ -128,6 +417,7 @@ public:
           clipBoxSize = Vec3{1,1,1};
           clipBoxShift = Vec3{0,0,0};
           updateMatrices();
+          updateTransferFunction();
           break;
         case GLENV_KEY_UP:
           zoom += 0.1f;
@@ -195,6 +485,7 @@ public:
       
       stepStart += float(xDelta/dim.width);
       stepWidth += float(yDelta/dim.height);
+      updateTransferFunction();
     }
     
     if (leftMouseDown) {
@@ -223,12 +514,35 @@ private:
   GLBuffer vbCube{GL_ARRAY_BUFFER};
   GLArray cubeArray;
   GLProgram cubeProgram{GLProgram::createFromFile("cubeVS.glsl", "cubeFS.glsl")};
+  std::vector<float> clippedCube;
   size_t vertCount;
   Volume volume;
   Vec3 voxelCount;
   Vec3 volumeExtend;
   GLTexture3D volumeTex{GL_LINEAR, GL_LINEAR,GL_CLAMP_TO_EDGE,
     GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE};
+  MacrocellGrid macrocells;
+  ShearWarp shearWarp;
+  bool shearWarpClassified{false};
+  PacketRaycaster packetRaycaster;
+  GLTexture3D macrocellTex{GL_NEAREST, GL_NEAREST,GL_CLAMP_TO_EDGE,
+    GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE};
+  TransferFunction transferFunction;
+  ResolutionController resolution;
+  GLFramebuffer framebuffer;
+  GLTexture2D renderTarget{GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE};
+  GLDepthBuffer renderDepth;
+  uint32_t renderWidth{1};
+  uint32_t renderHeight{1};
+  GradientVolume gradientVolume;
+  GLTexture3D gradientTex{GL_LINEAR, GL_LINEAR,GL_CLAMP_TO_EDGE,
+    GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE};
+  double gradientBuildTime{0.0};
+  GLTexture3D brickRangeTex{GL_NEAREST, GL_NEAREST,GL_CLAMP_TO_EDGE,
+    GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE};
+  GLTimerQuery raycastTimer;
+  GLTexture1D transferFunctionTex{GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE};
+  GLTexture2D preintegrationTex{GL_LINEAR, GL_LINEAR, GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE};
 
   ArcBall arcball{{512, 512}};
   Mat4 rotation;
@@ -245,6 +559,14 @@ private:
   Vec3 clipBoxShift{0,0,0};
 
   float oversampling{2.0f};
+  bool preintegration{true};
+  int shading{0};
+  Compositing compositing{Compositing::EmissionAbsorption};
+
+  TurntableSettings turntable;
+  std::unique_ptr<AsyncImageWriter> turntableWriter;
+  size_t turntableFrame{0};
+  std::chrono::high_resolution_clock::time_point turntableStart;
   float near{0.1f};
   float zoom{0.0f};
 
@@ -252,6 +574,8 @@ private:
 
   std::vector<std::string> filenames{"c60.dat","bonsai.dat"};
   size_t currentFile{0};
+  std::unique_ptr<FlowDerivatives> derivatives;
+  DerivedQuantity derivedQuantity{DerivedQuantity::VORTICITY};
   float stepStart{0.12f};
   float stepWidth{0.1f};
   bool leftMouseDown{false};
@@ -269,9 +593,32 @@ INT WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, INT nC
 int main(int argc, char** argv) {
 #endif
   try {
+#ifdef _WIN32
+    const int argc = __argc;
+    char** argv = __argv;
+#endif
+    if (argc > 1 && std::string(argv[1]) == "--turntable") {
+      const TurntableSettings settings = TurntableSettings::fromArguments(argc, argv);
+      if (!settings.gpu) {
+        Turntable::renderCPU(settings);
+        return EXIT_SUCCESS;
+      }
+      Raycaster raycaster{settings};
+      raycaster.run();
+      return EXIT_SUCCESS;
+    }
+
     Raycaster raycaster;
     raycaster.run();
   }
+  catch (const TurntableException& e) {
+    std::cerr << e.what() << std::endl << TurntableSettings::usage();
+    return EXIT_FAILURE;
+  }
+  catch (const QVisFileException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
   catch (const GLException& e) {
     std::stringstream ss;
     ss << "Insufficient OpenGL Support " << e.what();
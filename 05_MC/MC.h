@@ -1,7 +1,7 @@
 #pragma once
 
 #include <vector>
-#include "Volume.h"
+#include <Volume.h>
 
 struct Vertex {
   Vec3 position;
@@ -2,6 +2,9 @@
 #include <Mat4.h>
 #include <ArcBall.h>
 
+#include <Flowfield.h>
+#include <FlowDerivatives.h>
+
 #include "QVis.h"
 #include "MC.h"
 
@@ -9,6 +12,10 @@ class MyGLApp : public GLApp {
 public:
   std::vector<float> data;
   QVis q{"bonsai.dat"};
+  FlowDerivatives derivatives{Flowfield::genDemo(64, DemoType::CRITICAL)};
+  // 0 is the dataset, 1 to 4 the derived quantities of the demo flow
+  size_t source{0};
+  Volume volume{q.volume};
   uint8_t isovalue{40};
   float eye{2.0f};
   bool wireframe{false};
@@ -25,7 +32,7 @@ public:
   
   void extractIsosurface() {
     surfaceChanged = true;
-    Isosurface s{q.volume,isovalue};
+    Isosurface s{volume,isovalue};
     data.clear();
     for (const Vertex& v : s.vertices) {
       data.push_back(v.position[0]);
@@ -67,6 +74,20 @@ public:
         case GLENV_KEY_ESCAPE:
           closeWindow();
           break;
+        case GLENV_KEY_D:
+          source = (source + 1) % 5;
+          if (source == 0) {
+            volume = q.volume;
+            glEnv.setTitle("Marching Cubes demo");
+          } else {
+            // signed quantities map 0 to 128, so that is the vortex boundary
+            const DerivedQuantity quantity = DerivedQuantity(source - 1);
+            volume = derivatives.toVolume(quantity);
+            isovalue = 128;
+            glEnv.setTitle("Marching Cubes demo (" + toString(quantity) + ")");
+          }
+          extractIsosurface();
+          break;
         case GLENV_KEY_W:
           wireframe = !wireframe;
           surfaceChanged = true;
@@ -0,0 +1,258 @@
+#include <algorithm>
+
+#include "ParticleEngine.h"
+
+namespace {
+  // inserts two zero bits after each of the lower ten bits of v
+  uint32_t spreadBits(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+  }
+}
+
+std::string toString(Integrator integrator) {
+  switch (integrator) {
+    case Integrator::EULER : return "Euler";
+    case Integrator::RK2   : return "RK2";
+    case Integrator::RK4   : return "RK4";
+  }
+  return "";
+}
+
+ParticleEngine::ParticleEngine() :
+  integrator(Integrator::RK4),
+  respawnCount(0),
+  sortInterval(16),
+  stepsSinceSort(0)
+{
+}
+
+void ParticleEngine::seed(size_t count) {
+  x.resize(count);
+  y.resize(count);
+  z.resize(count);
+  renderData.resize(count*7);
+  freeList.clear();
+  respawnCount = 0;
+  // random seeds are sorted before the first step
+  stepsSinceSort = sortInterval;
+  for (size_t i = 0;i<count;++i) {
+    x[i] = random.rand01();
+    y[i] = random.rand01();
+    z[i] = random.rand01();
+    writeRenderData(i);
+  }
+}
+
+void ParticleEngine::writeRenderData(size_t index) {
+  float* target = renderData.data() + index*7;
+  target[0] = x[index]*2-1;
+  target[1] = y[index]*2-1;
+  target[2] = z[index]*2-1;
+  target[3] = x[index];
+  target[4] = y[index];
+  target[5] = z[index];
+  target[6] = 1.0f;
+}
+
+void ParticleEngine::respawn() {
+  respawnCount = freeList.size();
+  while (!freeList.empty()) {
+    const uint32_t index = freeList.back();
+    freeList.pop_back();
+    x[index] = random.rand01();
+    y[index] = random.rand01();
+    z[index] = random.rand01();
+    writeRenderData(index);
+  }
+}
+
+template <typename Field>
+void ParticleEngine::advect(const Field& flow, float deltaT) {
+  if (sortInterval > 0 && stepsSinceSort >= sortInterval) sort(flow);
+
+  // the Morton order already gives the chunks locality, bucketing them by
+  // brick again on every evaluation would only add overhead
+  const bool presorted = sortInterval > 0;
+  const size_t count = x.size();
+  const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+  std::vector<std::vector<uint32_t>> leaving(chunkCount);
+
+  #pragma omp parallel
+  {
+    // per thread stage velocities k, stage positions q and the weighted
+    // sum of the RK4 stages
+    std::vector<float> scratch(9*chunkSize);
+    float* const k[3] = {&scratch[0*chunkSize], &scratch[1*chunkSize], &scratch[2*chunkSize]};
+    float* const q[3] = {&scratch[3*chunkSize], &scratch[4*chunkSize], &scratch[5*chunkSize]};
+    float* const sum[3] = {&scratch[6*chunkSize], &scratch[7*chunkSize], &scratch[8*chunkSize]};
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t chunk = 0;chunk<int64_t(chunkCount);++chunk) {
+      const size_t start = size_t(chunk) * chunkSize;
+      const size_t size = std::min(chunkSize, count - start);
+      float* const p[3] = {x.data() + start, y.data() + start, z.data() + start};
+
+      auto evaluate = [&](float* const pos[3]) {
+        flow.interpolateBatch(pos[0], pos[1], pos[2], size, k[0], k[1], k[2], presorted);
+      };
+      auto step = [&](float* const target[3], float h) {
+        for (size_t c = 0;c<3;++c) {
+          for (size_t i = 0;i<size;++i) target[c][i] = p[c][i] + h * k[c][i];
+        }
+      };
+      auto accumulate = [&](float weight) {
+        for (size_t c = 0;c<3;++c) {
+          for (size_t i = 0;i<size;++i) sum[c][i] += weight * k[c][i];
+        }
+      };
+
+      switch (integrator) {
+        case Integrator::EULER :
+          evaluate(p);
+          step(p, deltaT);
+          break;
+        case Integrator::RK2 :
+          evaluate(p);
+          step(q, deltaT * 0.5f);
+          evaluate(q);
+          step(p, deltaT);
+          break;
+        case Integrator::RK4 :
+          for (size_t c = 0;c<3;++c) std::fill(sum[c], sum[c] + size, 0.0f);
+          evaluate(p);
+          accumulate(1.0f);
+          step(q, deltaT * 0.5f);
+          evaluate(q);
+          accumulate(2.0f);
+          step(q, deltaT * 0.5f);
+          evaluate(q);
+          accumulate(2.0f);
+          step(q, deltaT);
+          evaluate(q);
+          accumulate(1.0f);
+          for (size_t c = 0;c<3;++c) std::copy(sum[c], sum[c] + size, k[c]);
+          step(p, deltaT / 6.0f);
+          break;
+      }
+
+      for (size_t i = 0;i<size;++i) {
+        if (p[0][i] < 0.0f || p[0][i] > 1.0f || p[1][i] < 0.0f || p[1][i] > 1.0f ||
+            p[2][i] < 0.0f || p[2][i] > 1.0f)
+          leaving[size_t(chunk)].push_back(uint32_t(start + i));
+        else
+          writeRenderData(start + i);
+      }
+    }
+  }
+
+  for (const std::vector<uint32_t>& indices : leaving) {
+    freeList.insert(freeList.end(), indices.begin(), indices.end());
+  }
+  respawn();
+  ++stepsSinceSort;
+}
+
+template <typename Field>
+void ParticleEngine::sort(const Field& flow) {
+  const size_t size[3] = {flow.getSizeX(), flow.getSizeY(), flow.getSizeZ()};
+  sortByCell(size);
+}
+
+void ParticleEngine::sortByCell(const size_t size[3]) {
+  stepsSinceSort = 0;
+  const size_t count = x.size();
+  if (count < 2) return;
+
+  // cells per axis as in the interpolation, fields beyond 1024 cells per
+  // axis are sorted by groups of cells
+  uint32_t cellBits = 1;
+  float cellScale[3];
+  for (size_t a = 0;a<3;++a) {
+    const size_t cells = std::min<size_t>(std::max<size_t>(size[a], 2) - 1, size_t(1) << maxCellBits);
+    cellScale[a] = float(cells);
+    while ((size_t(1) << cellBits) < cells) ++cellBits;
+  }
+  const uint32_t maxCell = (1u << maxCellBits) - 1;
+  const float* const p[3] = {x.data(), y.data(), z.data()};
+
+  keys.resize(count);
+  order.resize(count);
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(count);++i) {
+    uint32_t key = 0;
+    for (size_t a = 0;a<3;++a) {
+      const uint32_t cell = std::min(uint32_t(std::clamp(p[a][i], 0.0f, 1.0f) * cellScale[a]), maxCell);
+      key |= spreadBits(cell) << a;
+    }
+    keys[size_t(i)] = key;
+    order[size_t(i)] = uint32_t(i);
+  }
+  radixSort(3*cellBits);
+
+  // gather the attributes in the new order, the render data follows the
+  // positions
+  positionScratch.resize(count);
+  for (std::vector<float>* attribute : {&x, &y, &z}) {
+    #pragma omp parallel for
+    for (int64_t i = 0;i<int64_t(count);++i) {
+      positionScratch[size_t(i)] = (*attribute)[order[size_t(i)]];
+    }
+    attribute->swap(positionScratch);
+  }
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(count);++i) writeRenderData(size_t(i));
+}
+
+void ParticleEngine::radixSort(uint32_t keyBits) {
+  // least significant digit first, every pass counts the digits of each
+  // block in parallel, turns the counts into per block offsets and
+  // scatters the blocks in parallel, which keeps the sort stable
+  const size_t count = keys.size();
+  const size_t blockCount = (count + sortBlockSize - 1) / sortBlockSize;
+  const size_t digitCount = size_t(1) << radixBits;
+  std::vector<uint32_t> offsets(blockCount*digitCount);
+  keyScratch.resize(count);
+  orderScratch.resize(count);
+
+  for (uint32_t shift = 0;shift<keyBits;shift+=radixBits) {
+    #pragma omp parallel for
+    for (int64_t block = 0;block<int64_t(blockCount);++block) {
+      uint32_t* histogram = offsets.data() + size_t(block)*digitCount;
+      std::fill(histogram, histogram + digitCount, 0);
+      const size_t end = std::min(count, size_t(block+1)*sortBlockSize);
+      for (size_t i = size_t(block)*sortBlockSize;i<end;++i) ++histogram[(keys[i] >> shift) & (digitCount-1)];
+    }
+
+    uint32_t sum = 0;
+    for (size_t digit = 0;digit<digitCount;++digit) {
+      for (size_t block = 0;block<blockCount;++block) {
+        const uint32_t digitCountInBlock = offsets[block*digitCount + digit];
+        offsets[block*digitCount + digit] = sum;
+        sum += digitCountInBlock;
+      }
+    }
+
+    #pragma omp parallel for
+    for (int64_t block = 0;block<int64_t(blockCount);++block) {
+      uint32_t* target = offsets.data() + size_t(block)*digitCount;
+      const size_t end = std::min(count, size_t(block+1)*sortBlockSize);
+      for (size_t i = size_t(block)*sortBlockSize;i<end;++i) {
+        const uint32_t position = target[(keys[i] >> shift) & (digitCount-1)]++;
+        keyScratch[position] = keys[i];
+        orderScratch[position] = order[i];
+      }
+    }
+    keys.swap(keyScratch);
+    order.swap(orderScratch);
+  }
+}
+
+template void ParticleEngine::advect<Flowfield>(const Flowfield& flow, float deltaT);
+template void ParticleEngine::advect<HalfFlowfield>(const HalfFlowfield& flow, float deltaT);
+template void ParticleEngine::sort<Flowfield>(const Flowfield& flow);
+template void ParticleEngine::sort<HalfFlowfield>(const HalfFlowfield& flow);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Rand.h>
+
+#include "Flowfield.h"
+
+enum class Integrator {
+  EULER,
+  RK2,
+  RK4
+};
+
+std::string toString(Integrator integrator);
+
+// Particles in [0,1]^3 stored as structure of arrays and advected in
+// parallel chunks through Flowfield::interpolateBatch. Particles leaving
+// the domain are put on a free list and respawned at random positions.
+// The render data is written during advection in the layout of
+// GLApp::drawPoints, seven floats (position, color, alpha) per particle.
+// Every sortInterval steps the particles are reordered by the Morton code
+// of their cell with a parallel radix sort, so the chunks cover compact
+// regions of the field and neighboring particles share cells in cache.
+class ParticleEngine {
+public:
+  ParticleEngine();
+
+  void seed(size_t count);
+
+  template <typename Field>
+  void advect(const Field& flow, float deltaT);
+
+  // reorders the particles right away, advect calls it periodically
+  template <typename Field>
+  void sort(const Field& flow);
+
+  void setIntegrator(Integrator integrator) {this->integrator = integrator;}
+  Integrator getIntegrator() const {return integrator;}
+  // 0 disables the periodic sorting
+  void setSortInterval(size_t steps) {sortInterval = steps;}
+  size_t getSortInterval() const {return sortInterval;}
+
+  size_t getParticleCount() const {return x.size();}
+  size_t getRespawnCount() const {return respawnCount;}
+  const std::vector<float>& getRenderData() const {return renderData;}
+
+private:
+  static constexpr size_t chunkSize = 4096;
+  static constexpr size_t sortBlockSize = 65536;
+  static constexpr uint32_t radixBits = 8;
+  static constexpr uint32_t maxCellBits = 10;
+
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<uint32_t> freeList;
+  std::vector<float> renderData;
+  Integrator integrator;
+  size_t respawnCount;
+  size_t sortInterval;
+  size_t stepsSinceSort;
+  Random random;
+
+  std::vector<uint32_t> keys;
+  std::vector<uint32_t> order;
+  std::vector<uint32_t> keyScratch;
+  std::vector<uint32_t> orderScratch;
+  std::vector<float> positionScratch;
+
+  void respawn();
+  void writeRenderData(size_t index);
+  void sortByCell(const size_t size[3]);
+  void radixSort(uint32_t keyBits);
+};
@@ -1,15 +1,18 @@
+#include <chrono>
+#include <sstream>
+
 #include <GLApp.h>
 #include <Mat4.h>
 #include <ArcBall.h>
 
 #include "Flowfield.h"
+#include "ParticleEngine.h"
 
 class MyGLApp : public GLApp {
 public:
   size_t particleCount{1000};
   double lastAnimationTime{0};
-  std::vector<Vec3> particlePositions;
-  std::vector<float> data;
+  ParticleEngine particles;
   Flowfield flow = Flowfield::genDemo(64, DemoType::SATTLE);
   ArcBall arcball{{512, 512}};
   Mat4 rotation;
@@ -24,35 +27,27 @@ public:
   }
 
   void initParticles() {
-    particlePositions.resize(particleCount);
-    for (size_t i = 0;i<particlePositions.size();++i) {
-      particlePositions[i] = Vec3::random();
-    }
-    data.resize(particlePositions.size()*7);
+    particles.seed(particleCount);
   }
   
   void advect(double deltaT) {
-    // TODO: advect the particles
-  }
+    const auto start = std::chrono::high_resolution_clock::now();
+    particles.advect(flow, float(deltaT));
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
 
-  void particlePositionsToRenderData() {
-    for (size_t i = 0;i<particlePositions.size();++i) {
-      data[i*7+0] = particlePositions[i].x*2-1;
-      data[i*7+1] = particlePositions[i].y*2-1;
-      data[i*7+2] = particlePositions[i].z*2-1;
-      
-      data[i*7+3] = particlePositions[i].x;
-      data[i*7+4] = particlePositions[i].y;
-      data[i*7+5] = particlePositions[i].z;
-      data[i*7+6] = 1.0f;
-    }
+    std::stringstream ss;
+    ss << "Flow Vis Demo 1 (Particle Tracing, " << particles.getParticleCount() << " particles, "
+       << toString(particles.getIntegrator()) << ", "
+       << (particles.getSortInterval() > 0 ? "Morton sorted" : "unsorted") << ": "
+       << duration.count() << " ms per step)";
+    glEnv.setTitle(ss.str());
   }
   
   virtual void animate(double animationTime) override {
     const double deltaT = animationTime - lastAnimationTime;
     lastAnimationTime = animationTime;
     advect(deltaT*10);
-    particlePositionsToRenderData();
   }
   
   virtual void draw() override {
@@ -60,7 +55,7 @@ public:
     setDrawProjection(Mat4::perspective(45, glEnv.getFramebufferSize().aspect(), 0.0001f, 100));
     setDrawTransform(Mat4::lookAt({0,0,5},{0,0,0},{0,1,0}) * rotation);
     
-    drawPoints(data, 4, false);
+    drawPoints(particles.getRenderData(), particleCount > 100000 ? 1.0f : 4.0f, false);
   }
   
   virtual void resize(int width, int height) override {
@@ -92,6 +87,20 @@ public:
         case GLENV_KEY_I:
           initParticles();
           break;
+        case GLENV_KEY_M:
+          particles.setIntegrator(Integrator((int(particles.getIntegrator()) + 1) % 3));
+          break;
+        case GLENV_KEY_S:
+          particles.setSortInterval(particles.getSortInterval() > 0 ? 0 : 16);
+          break;
+        case GLENV_KEY_UP:
+          particleCount = std::min<size_t>(particleCount * 10, 10000000);
+          initParticles();
+          break;
+        case GLENV_KEY_DOWN:
+          particleCount = std::max<size_t>(particleCount / 10, 1);
+          initParticles();
+          break;
       }
     }
   }
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Flowfield.h"
+#include "EvenlySpacedStreamlines.h"
+
+namespace {
+  bool inDomain(const Vec3& p) {
+    return p.x >= 0.0f && p.y >= 0.0f && p.z >= 0.0f && p.x <= 1.0f && p.y <= 1.0f && p.z <= 1.0f;
+  }
+}
+
+EvenlySpacedStreamlines::SeparationGrid::SeparationGrid(float cellSize) :
+  cellSize(cellSize),
+  size(std::max<int64_t>(1, int64_t(std::ceil(1.0f / cellSize)))),
+  cells(size_t(size*size*size))
+{
+}
+
+int64_t EvenlySpacedStreamlines::SeparationGrid::cellCoord(float v) const {
+  return std::clamp(int64_t(std::floor(v / cellSize)), int64_t(0), size-1);
+}
+
+void EvenlySpacedStreamlines::SeparationGrid::insert(const std::vector<Vec3>& points) {
+  for (const Vec3& p : points) {
+    cells[size_t(cellCoord(p.x) + size*(cellCoord(p.y) + size*cellCoord(p.z)))].push_back(p);
+  }
+}
+
+bool EvenlySpacedStreamlines::SeparationGrid::isOccupied(const Vec3& p, float radius) const {
+  const int64_t cx = cellCoord(p.x);
+  const int64_t cy = cellCoord(p.y);
+  const int64_t cz = cellCoord(p.z);
+  const float radiusSquared = radius*radius;
+  for (int64_t z = std::max<int64_t>(cz-1, 0);z<=std::min(cz+1, size-1);++z) {
+    for (int64_t y = std::max<int64_t>(cy-1, 0);y<=std::min(cy+1, size-1);++y) {
+      for (int64_t x = std::max<int64_t>(cx-1, 0);x<=std::min(cx+1, size-1);++x) {
+        for (const Vec3& q : cells[size_t(x + size*(y + size*z))]) {
+          if ((q-p).sqlength() < radiusSquared) return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+template <typename Field>
+size_t EvenlySpacedStreamlines::integrate(const Field& flow, const SeparationGrid& grid,
+                                          const EvenlySpacedSettings& settings,
+                                          Vec3 p, float direction, std::vector<Vec3>& points) {
+  const float testRadius = settings.testRatio*settings.separation;
+  size_t evaluations = 0;
+  auto tangent = [&](const Vec3& q, Vec3& t) {
+    const Vec3 v = flow.interpolate(q);
+    ++evaluations;
+    const float length = v.length();
+    if (length < 1e-7f) return false;
+    t = v * (direction / length);
+    return true;
+  };
+
+  while (points.size() < settings.maxPoints) {
+    Vec3 t;
+    if (!tangent(p, t) || !tangent(p + t*(settings.stepSize*0.5f), t)) break;
+    p = p + t*settings.stepSize;
+    if (!inDomain(p) || grid.isOccupied(p, testRadius)) break;
+    points.push_back(p);
+  }
+  return evaluations;
+}
+
+template <typename Field>
+void EvenlySpacedStreamlines::traceCandidate(const Field& flow, const SeparationGrid& grid,
+                                             const EvenlySpacedSettings& settings, Candidate& candidate) {
+  candidate.backward.clear();
+  candidate.forward.clear();
+  candidate.evaluations = 0;
+  // seeds lie exactly at the separation distance of their source point,
+  // a little slack keeps rounding from rejecting them
+  candidate.valid = inDomain(candidate.seed) && !grid.isOccupied(candidate.seed, settings.separation*0.99f);
+  if (!candidate.valid) return;
+  candidate.evaluations = integrate(flow, grid, settings, candidate.seed, -1.0f, candidate.backward) +
+                          integrate(flow, grid, settings, candidate.seed, 1.0f, candidate.forward);
+}
+
+template <typename Field>
+Streamlines EvenlySpacedStreamlines::place(const Field& flow, const EvenlySpacedSettings& settings,
+                                           const Vec3& firstSeed) {
+  const float separation = settings.separation;
+  const float testRadius = settings.testRatio*separation;
+  const size_t pointStride = std::max<size_t>(1, size_t(0.5f*separation / settings.stepSize));
+  const size_t latticeSize = std::max<size_t>(1, size_t(std::ceil(1.0f / separation)));
+  const size_t latticeCount = latticeSize*latticeSize*latticeSize;
+
+  SeparationGrid grid(separation);
+  std::vector<std::vector<Vec3>> lines;
+  Streamlines result;
+
+  // candidates come from the first seed, then from four perpendicular
+  // offsets at every pointStride-th point of the accepted lines in order
+  // of acceptance and finally from the lattice to reach separate regions
+  bool firstSeedUsed = false;
+  size_t sourceLine = 0, sourcePoint = 0, sourceOffset = 0;
+  size_t latticeIndex = 0;
+  auto nextLineCandidate = [&](Vec3& seed) {
+    if (!firstSeedUsed) {
+      firstSeedUsed = true;
+      seed = firstSeed;
+      return true;
+    }
+    while (sourceLine < lines.size()) {
+      const std::vector<Vec3>& line = lines[sourceLine];
+      if (sourcePoint >= line.size()) {
+        ++sourceLine;
+        sourcePoint = 0;
+        continue;
+      }
+      const Vec3 tangent = Vec3::normalize(line[std::min(sourcePoint+1, line.size()-1)] -
+                                           line[sourcePoint > 0 ? sourcePoint-1 : 0]);
+      const Vec3 axis = std::fabs(tangent.x) < 0.6f ? Vec3{1.0f, 0.0f, 0.0f} : Vec3{0.0f, 1.0f, 0.0f};
+      const Vec3 normal = Vec3::normalize(Vec3::cross(tangent, axis));
+      const Vec3 offsets[4] = {normal, normal*-1.0f, Vec3::cross(tangent, normal), Vec3::cross(tangent, normal)*-1.0f};
+      seed = line[sourcePoint] + offsets[sourceOffset]*separation;
+      if (++sourceOffset == 4) {
+        sourceOffset = 0;
+        sourcePoint += pointStride;
+      }
+      return true;
+    }
+    return false;
+  };
+  auto nextLatticeCandidate = [&](Vec3& seed) {
+    if (latticeIndex == latticeCount) return false;
+    seed = Vec3{float(latticeIndex % latticeSize) + 0.5f,
+                float((latticeIndex / latticeSize) % latticeSize) + 0.5f,
+                float(latticeIndex / (latticeSize*latticeSize)) + 0.5f} / float(latticeSize);
+    ++latticeIndex;
+    return true;
+  };
+
+  std::vector<Candidate> batch(std::max<size_t>(1, settings.batchSize));
+  while (true) {
+    // a batch takes lattice candidates only if no line offers one, so the
+    // lines committed by this batch are used as sources first
+    size_t count = 0;
+    while (count < batch.size() && nextLineCandidate(batch[count].seed)) ++count;
+    if (count == 0) {
+      while (count < batch.size() && nextLatticeCandidate(batch[count].seed)) ++count;
+    }
+    if (count == 0) break;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int64_t i = 0;i<int64_t(count);++i) {
+      traceCandidate(flow, grid, settings, batch[size_t(i)]);
+    }
+
+    for (size_t i = 0;i<count;++i) {
+      const Candidate& candidate = batch[i];
+      result.evaluations += candidate.evaluations;
+      if (!candidate.valid || grid.isOccupied(candidate.seed, separation*0.99f)) continue;
+
+      // clip against the lines committed earlier in this batch
+      size_t backwardCount = 0, forwardCount = 0;
+      while (backwardCount < candidate.backward.size() &&
+             !grid.isOccupied(candidate.backward[backwardCount], testRadius)) ++backwardCount;
+      while (forwardCount < candidate.forward.size() &&
+             !grid.isOccupied(candidate.forward[forwardCount], testRadius)) ++forwardCount;
+      if (backwardCount + forwardCount + 1 < settings.minPoints) continue;
+
+      std::vector<Vec3> line(candidate.backward.rend() - int64_t(backwardCount), candidate.backward.rend());
+      line.push_back(candidate.seed);
+      line.insert(line.end(), candidate.forward.begin(), candidate.forward.begin() + int64_t(forwardCount));
+      grid.insert(line);
+      lines.push_back(std::move(line));
+    }
+  }
+
+  result.offsets.resize(lines.size()+1);
+  for (size_t i = 0;i<lines.size();++i) {
+    result.offsets[i+1] = result.offsets[i] + lines[i].size();
+    result.points.insert(result.points.end(), lines[i].begin(), lines[i].end());
+  }
+  return result;
+}
+
+template Streamlines EvenlySpacedStreamlines::place<Flowfield>(const Flowfield& flow,
+                                                               const EvenlySpacedSettings& settings,
+                                                               const Vec3& firstSeed);
+template Streamlines EvenlySpacedStreamlines::place<HalfFlowfield>(const HalfFlowfield& flow,
+                                                                   const EvenlySpacedSettings& settings,
+                                                                   const Vec3& firstSeed);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include <Vec3.h>
+
+#include "StreamlineTracer.h"
+
+struct EvenlySpacedSettings {
+  float separation{0.05f};    // distance of seeds to all lines
+  float testRatio{0.5f};      // lines end closer than testRatio*separation to another line
+  float stepSize{0.0125f};    // fixed step along the normalized field
+  size_t maxPoints{1000};     // per direction of a line
+  size_t minPoints{8};        // shorter lines are dropped
+  size_t batchSize{16};       // candidates traced in parallel per round
+};
+
+// Evenly spaced streamlines in [0,1]^3 after Jobard and Lefer: new seeds
+// are placed at the separation distance perpendicular to the accepted
+// lines (and on a regular lattice once those run out), a seed is valid
+// if no line is closer than the separation and a line stops when it gets
+// closer than testRatio*separation to another one. The points of the
+// accepted lines are kept in a uniform grid with cells of the separation
+// size, so every distance query looks at 27 cells. Batches of candidates
+// are validated and traced in parallel against the lines accepted so far,
+// then committed in order, each one clipped against the lines committed
+// before it in the same batch. The result does not depend on the thread
+// count.
+class EvenlySpacedStreamlines {
+public:
+  template <typename Field>
+  static Streamlines place(const Field& flow, const EvenlySpacedSettings& settings=EvenlySpacedSettings{},
+                           const Vec3& firstSeed=Vec3{0.5f, 0.5f, 0.5f});
+
+private:
+  class SeparationGrid {
+  public:
+    SeparationGrid(float cellSize);
+    void insert(const std::vector<Vec3>& points);
+    // true if a point is closer than radius (at most the cell size) to p
+    bool isOccupied(const Vec3& p, float radius) const;
+
+  private:
+    float cellSize;
+    int64_t size;
+    std::vector<std::vector<Vec3>> cells;
+
+    int64_t cellCoord(float v) const;
+  };
+
+  struct Candidate {
+    Vec3 seed;
+    bool valid;
+    std::vector<Vec3> backward;
+    std::vector<Vec3> forward;
+    size_t evaluations;
+  };
+
+  template <typename Field>
+  static void traceCandidate(const Field& flow, const SeparationGrid& grid,
+                             const EvenlySpacedSettings& settings, Candidate& candidate);
+  template <typename Field>
+  static size_t integrate(const Field& flow, const SeparationGrid& grid, const EvenlySpacedSettings& settings,
+                          Vec3 p, float direction, std::vector<Vec3>& points);
+};
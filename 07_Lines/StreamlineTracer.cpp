@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Flowfield.h"
+#include "StreamlineTracer.h"
+
+namespace {
+  // Dormand-Prince tableau, b holds the fifth order weights (which are
+  // also the last stage, so its derivative is reused by the next step)
+  // and e the difference to the embedded fourth order solution
+  const float a21 = 1.0f/5.0f;
+  const float a31 = 3.0f/40.0f,       a32 = 9.0f/40.0f;
+  const float a41 = 44.0f/45.0f,      a42 = -56.0f/15.0f,      a43 = 32.0f/9.0f;
+  const float a51 = 19372.0f/6561.0f, a52 = -25360.0f/2187.0f, a53 = 64448.0f/6561.0f, a54 = -212.0f/729.0f;
+  const float a61 = 9017.0f/3168.0f,  a62 = -355.0f/33.0f,     a63 = 46732.0f/5247.0f, a64 = 49.0f/176.0f,
+              a65 = -5103.0f/18656.0f;
+  const float b1 = 35.0f/384.0f, b3 = 500.0f/1113.0f, b4 = 125.0f/192.0f, b5 = -2187.0f/6784.0f, b6 = 11.0f/84.0f;
+  const float e1 = 71.0f/57600.0f, e3 = -71.0f/16695.0f, e4 = 71.0f/1920.0f, e5 = -17253.0f/339200.0f,
+              e6 = 22.0f/525.0f, e7 = -1.0f/40.0f;
+
+  bool inDomain(const Vec3& p) {
+    return p.x >= 0.0f && p.y >= 0.0f && p.z >= 0.0f && p.x <= 1.0f && p.y <= 1.0f && p.z <= 1.0f;
+  }
+}
+
+template <typename Field>
+size_t StreamlineTracer::traceLine(const Field& flow, const Vec3& seed,
+                                   const StreamlineSettings& settings, std::vector<Vec3>& line) {
+  line.clear();
+  if (!inDomain(seed) || settings.maxPoints == 0) return 0;
+  line.push_back(seed);
+
+  Vec3 p = seed;
+  Vec3 k1 = flow.interpolate(p);
+  size_t evaluations = 1;
+  float h = settings.initialStep;
+  while (line.size() < settings.maxPoints && k1.length() > 1e-7f) {
+    const Vec3 k2 = flow.interpolate(p + (k1*a21)*h);
+    const Vec3 k3 = flow.interpolate(p + (k1*a31 + k2*a32)*h);
+    const Vec3 k4 = flow.interpolate(p + (k1*a41 + k2*a42 + k3*a43)*h);
+    const Vec3 k5 = flow.interpolate(p + (k1*a51 + k2*a52 + k3*a53 + k4*a54)*h);
+    const Vec3 k6 = flow.interpolate(p + (k1*a61 + k2*a62 + k3*a63 + k4*a64 + k5*a65)*h);
+    const Vec3 next = p + (k1*b1 + k3*b3 + k4*b4 + k5*b5 + k6*b6)*h;
+    const Vec3 k7 = flow.interpolate(next);
+    evaluations += 6;
+
+    const Vec3 error = (k1*e1 + k3*e3 + k4*e4 + k5*e5 + k6*e6 + k7*e7)*h;
+    const float errorNorm = std::max(std::fabs(error.x), std::max(std::fabs(error.y), std::fabs(error.z)));
+
+    // classic controller with safety factor, growth and shrinkage limited
+    const float factor = errorNorm > 0.0f ?
+                         std::clamp(0.9f*std::pow(settings.tolerance/errorNorm, 0.2f), 0.2f, 5.0f) : 5.0f;
+
+    if (errorNorm > settings.tolerance) {
+      if (h <= settings.minStep) break;
+      h = std::max(h*factor, settings.minStep);
+      continue;
+    }
+
+    if (!inDomain(next)) break;
+    line.push_back(next);
+    p = next;
+    k1 = k7;
+    h = std::clamp(h*factor, settings.minStep, settings.maxStep);
+  }
+  return evaluations;
+}
+
+template <typename Field>
+Streamlines StreamlineTracer::trace(const Field& flow, const std::vector<Vec3>& seeds,
+                                    const StreamlineSettings& settings) {
+  std::vector<std::vector<Vec3>> lines(seeds.size());
+  std::vector<size_t> evaluations(seeds.size());
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0;i<int64_t(seeds.size());++i) {
+    evaluations[size_t(i)] = traceLine(flow, seeds[size_t(i)], settings, lines[size_t(i)]);
+  }
+
+  Streamlines result;
+  result.offsets.resize(seeds.size()+1);
+  for (size_t i = 0;i<lines.size();++i) {
+    result.offsets[i+1] = result.offsets[i] + lines[i].size();
+    result.evaluations += evaluations[i];
+  }
+  result.points.resize(result.offsets.back());
+
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(lines.size());++i) {
+    std::copy(lines[size_t(i)].begin(), lines[size_t(i)].end(), result.points.begin() + int64_t(result.offsets[size_t(i)]));
+  }
+  return result;
+}
+
+template Streamlines StreamlineTracer::trace<Flowfield>(const Flowfield& flow, const std::vector<Vec3>& seeds,
+                                                        const StreamlineSettings& settings);
+template Streamlines StreamlineTracer::trace<HalfFlowfield>(const HalfFlowfield& flow, const std::vector<Vec3>& seeds,
+                                                            const StreamlineSettings& settings);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include <Vec3.h>
+
+struct StreamlineSettings {
+  float tolerance{1e-4f};     // largest accepted local error per step
+  float initialStep{0.01f};
+  float minStep{1e-5f};
+  float maxStep{0.2f};
+  size_t maxPoints{300};
+};
+
+// Integral curves stored back to back, line l consists of the points
+// [offsets[l], offsets[l+1])
+struct Streamlines {
+  std::vector<Vec3> points;
+  std::vector<size_t> offsets{0};
+  size_t evaluations{0};
+
+  size_t getLineCount() const {return offsets.size()-1;}
+  size_t getLineLength(size_t line) const {return offsets[line+1]-offsets[line];}
+};
+
+// Streamlines of a steady field in [0,1]^3 integrated with the embedded
+// Dormand-Prince 5(4) scheme. The step size follows the error estimate,
+// so slow regions get few long steps and fast regions short accurate ones.
+// A line ends when it leaves the domain, reaches a critical point, needs
+// a step below minStep or has maxPoints points. Seeds are traced in parallel.
+class StreamlineTracer {
+public:
+  template <typename Field>
+  static Streamlines trace(const Field& flow, const std::vector<Vec3>& seeds,
+                           const StreamlineSettings& settings=StreamlineSettings{});
+
+private:
+  template <typename Field>
+  static size_t traceLine(const Field& flow, const Vec3& seed,
+                          const StreamlineSettings& settings, std::vector<Vec3>& line);
+};
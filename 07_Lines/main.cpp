@@ -1,8 +1,13 @@
+#include <chrono>
+#include <sstream>
+
 #include <GLApp.h>
 #include <Mat4.h>
 #include <ArcBall.h>
 
 #include "Flowfield.h"
+#include "StreamlineTracer.h"
+#include "EvenlySpacedStreamlines.h"
 
 class MyGLApp : public GLApp {
 public:
@@ -13,6 +18,7 @@ public:
   size_t lineCount{200};
   size_t lineLength{300};
   double angle{0};
+  bool evenlySpaced{false};
   std::vector<float> data;
   Flowfield flow = Flowfield::genDemo(128, DemoType::SATTLE);
   
@@ -22,27 +28,45 @@ public:
   }
 
   void initLines() {
-    std::vector<Vec3> linePoints;
-    linePoints.resize(lineCount*lineLength);
+    const auto start = std::chrono::high_resolution_clock::now();
+    Streamlines lines;
+    if (evenlySpaced) {
+      lines = EvenlySpacedStreamlines::place(flow);
+    } else {
+      std::vector<Vec3> seeds(lineCount);
+      for (Vec3& seed : seeds) seed = Vec3::random();
+
+      StreamlineSettings settings;
+      settings.maxPoints = lineLength;
+      lines = StreamlineTracer::trace(flow, seeds, settings);
+    }
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
 
-    // TODO compute integral curves here
+    std::stringstream ss;
+    ss << "Flow Vis Demo 2 (Integral Curves, " << (evenlySpaced ? "evenly spaced, " : "random seeds, ")
+       << lines.getLineCount() << " lines, " << lines.points.size() << " points, "
+       << lines.evaluations << " field evaluations, " << duration.count() << " ms)";
+    glEnv.setTitle(ss.str());
 
-    linePointsToRenderData(linePoints);
+    linePointsToRenderData(lines);
   }
   
 
-  void linePointsToRenderData(const std::vector<Vec3>& linePoints) {
+  void linePointsToRenderData(const Streamlines& lines) {
+    const std::vector<Vec3>& linePoints = lines.points;
+
     // 2 -> line start and line end point
     // 7 -> x,y,z coord plus r,g,b,a color components
-    data.resize(lineCount*(lineLength-1)*2*7);
+    size_t segmentCount = 0;
+    for (size_t l = 0;l<lines.getLineCount();++l) {
+      segmentCount += std::max<size_t>(lines.getLineLength(l), 1) - 1;
+    }
+    data.resize(segmentCount*2*7);
 
     size_t i = 0;
-    for (size_t l = 0;l<lineCount;++l) {
-      for (size_t s = 0;s<lineLength-1;++s) {
-        size_t j = l*lineLength + s;
-        
-        if (linePoints[j] == linePoints[j+1]) break;
-        
+    for (size_t l = 0;l<lines.getLineCount();++l) {
+      for (size_t j = lines.offsets[l];j+1<lines.offsets[l+1];++j) {
         data[i++] = linePoints[j].x*2-1;
         data[i++] = linePoints[j].y*2-1;
         data[i++] = linePoints[j].z*2-1;
@@ -52,15 +76,13 @@ public:
         data[i++] = linePoints[j].z;
         data[i++] = 1.0f;
 
-        j++;
-        
-        data[i++] = linePoints[j].x*2-1;
-        data[i++] = linePoints[j].y*2-1;
-        data[i++] = linePoints[j].z*2-1;
+        data[i++] = linePoints[j+1].x*2-1;
+        data[i++] = linePoints[j+1].y*2-1;
+        data[i++] = linePoints[j+1].z*2-1;
         
-        data[i++] = linePoints[j].x;
-        data[i++] = linePoints[j].y;
-        data[i++] = linePoints[j].z;
+        data[i++] = linePoints[j+1].x;
+        data[i++] = linePoints[j+1].y;
+        data[i++] = linePoints[j+1].z;
         data[i++] = 1.0f;
       }
     }
@@ -82,6 +104,13 @@ public:
         case GLENV_KEY_ESCAPE:
           closeWindow();
           break;
+        case GLENV_KEY_I:
+          initLines();
+          break;
+        case GLENV_KEY_E:
+          evenlySpaced = !evenlySpaced;
+          initLines();
+          break;
       }
     }
   }
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "Flowfield.h"
+#include "StreaklineEngine.h"
+#include "StreamingFlowfield4D.h"
+
+StreaklineEngine::StreaklineEngine() :
+  lineLength(0),
+  liveCount(0),
+  head(0),
+  time(0.0f)
+{
+}
+
+void StreaklineEngine::seed(const std::vector<Vec3>& seeds, size_t lineLength, float startTime) {
+  this->seeds = seeds;
+  this->lineLength = std::max<size_t>(1, lineLength);
+  liveCount = 1;
+  head = 0;
+  time = startTime;
+
+  x.resize(seeds.size()*this->lineLength);
+  y.resize(x.size());
+  z.resize(x.size());
+  for (size_t l = 0;l<seeds.size();++l) {
+    const size_t start = l*this->lineLength;
+    std::fill(x.begin() + int64_t(start), x.begin() + int64_t(start + this->lineLength), seeds[l].x);
+    std::fill(y.begin() + int64_t(start), y.begin() + int64_t(start + this->lineLength), seeds[l].y);
+    std::fill(z.begin() + int64_t(start), z.begin() + int64_t(start + this->lineLength), seeds[l].z);
+  }
+}
+
+template <typename Field>
+void StreaklineEngine::advance(const Field& flow, float deltaT) {
+  // until the ring is full the live particles are the slots [0, liveCount)
+  const size_t count = liveCount;
+
+  #pragma omp parallel
+  {
+    std::vector<float> velocity(3*lineLength);
+    float* const v[3] = {&velocity[0], &velocity[lineLength], &velocity[2*lineLength]};
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t l = 0;l<int64_t(seeds.size());++l) {
+      const size_t start = size_t(l)*lineLength;
+      float* const p[3] = {x.data() + start, y.data() + start, z.data() + start};
+      flow.interpolateBatch(p[0], p[1], p[2], count, time, v[0], v[1], v[2]);
+      for (size_t i = 0;i<count;++i) {
+        if (p[0][i] < 0.0f || p[0][i] > 1.0f || p[1][i] < 0.0f || p[1][i] > 1.0f ||
+            p[2][i] < 0.0f || p[2][i] > 1.0f) continue;
+        for (size_t c = 0;c<3;++c) p[c][i] += v[c][i] * deltaT;
+      }
+    }
+  }
+  time += deltaT;
+
+  head = (head + 1) % lineLength;
+  liveCount = std::min(liveCount + 1, lineLength);
+  for (size_t l = 0;l<seeds.size();++l) {
+    x[l*lineLength + head] = seeds[l].x;
+    y[l*lineLength + head] = seeds[l].y;
+    z[l*lineLength + head] = seeds[l].z;
+  }
+}
+
+void StreaklineEngine::getLinePoints(std::vector<Vec3>& points) const {
+  points.resize(seeds.size()*lineLength);
+  #pragma omp parallel for
+  for (int64_t l = 0;l<int64_t(seeds.size());++l) {
+    const size_t start = size_t(l)*lineLength;
+    for (size_t i = 0;i<lineLength;++i) {
+      const size_t slot = start + (head + lineLength - std::min(i, liveCount-1)) % lineLength;
+      points[start + i] = Vec3{x[slot], y[slot], z[slot]};
+    }
+  }
+}
+
+template void StreaklineEngine::advance<Flowfield4D>(const Flowfield4D& flow, float deltaT);
+template void StreaklineEngine::advance<HalfFlowfield4D>(const HalfFlowfield4D& flow, float deltaT);
+template void StreaklineEngine::advance<StreamingFlowfield4D>(const StreamingFlowfield4D& flow, float deltaT);
+template void StreaklineEngine::advance<HalfStreamingFlowfield4D>(const HalfStreamingFlowfield4D& flow, float deltaT);
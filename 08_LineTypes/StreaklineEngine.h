@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include <Vec3.h>
+
+// Streaklines of fixed seeds in [0,1]^3. The particles of every line live
+// in a ring buffer of lineLength slots, each advance moves all of them by
+// one Euler step and then releases a new particle at the seed into the
+// slot of the oldest one. So a step costs one field evaluation per live
+// particle instead of re-advecting every particle from its release time.
+// Particles that left the domain stay where they left it. Lines are
+// advanced in parallel.
+class StreaklineEngine {
+public:
+  StreaklineEngine();
+
+  void seed(const std::vector<Vec3>& seeds, size_t lineLength, float startTime=0.0f);
+
+  template <typename Field>
+  void advance(const Field& flow, float deltaT);
+
+  size_t getLineCount() const {return seeds.size();}
+  size_t getMaxLineLength() const {return lineLength;}
+  size_t getLiveCount() const {return liveCount;}
+  float getTime() const {return time;}
+
+  // lineLength points per line ordered from the seed to the oldest
+  // particle, lines that are not full yet repeat their oldest particle
+  void getLinePoints(std::vector<Vec3>& points) const;
+
+private:
+  std::vector<Vec3> seeds;
+  size_t lineLength;
+  size_t liveCount;
+  size_t head;
+  float time;
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+};
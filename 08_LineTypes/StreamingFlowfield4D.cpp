@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <stdexcept>
+
+#include "Flowfield.h"
+#include "StreamingFlowfield4D.h"
+
+template <typename Format>
+BasicStreamingFlowfield4D<Format>::BasicStreamingFlowfield4D(const std::string& filename, size_t windowSize) :
+  filename(filename),
+  interval(0),
+  lower(nullptr),
+  upper(nullptr),
+  finished(false),
+  loadedCount(0)
+{
+  std::ifstream file(filename, std::ios::binary);
+  FlowfieldFileHeader header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !header.isValid()) {
+    std::stringstream s;
+    s << "Can't read time series from file " << filename;
+    throw std::runtime_error(s.str());
+  }
+  sizeX = size_t(header.sizeX);
+  sizeY = size_t(header.sizeY);
+  sizeZ = size_t(header.sizeZ);
+  timesteps = size_t(header.timesteps);
+
+  slots.resize(std::max<size_t>(2, windowSize));
+  for (Slot& slot : slots) slot.data.resize(sizeX*sizeY*sizeZ);
+
+  thread = std::thread(&BasicStreamingFlowfield4D::run, this);
+  try {
+    setInterval(0);
+  } catch (...) {
+    // the destructor won't run, stop the loader before it outlives this
+    stop();
+    throw;
+  }
+}
+
+template <typename Format>
+BasicStreamingFlowfield4D<Format>::~BasicStreamingFlowfield4D() {
+  stop();
+}
+
+template <typename Format>
+void BasicStreamingFlowfield4D<Format>::stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+  }
+  stateChanged.notify_all();
+  if (thread.joinable()) thread.join();
+}
+
+template <typename Format>
+typename BasicStreamingFlowfield4D<Format>::Slot* BasicStreamingFlowfield4D<Format>::find(size_t timeStep) {
+  for (Slot& slot : slots) {
+    if (slot.state != SlotState::EMPTY && slot.timeStep == timeStep) return &slot;
+  }
+  return nullptr;
+}
+
+template <typename Format>
+void BasicStreamingFlowfield4D<Format>::setInterval(size_t timeStep) {
+  const size_t first = timeStep % timesteps;
+  const size_t second = (timeStep+1) % timesteps;
+  const size_t windowSteps = std::min(slots.size(), timesteps);
+  auto inWindow = [&](size_t step) {return (step + timesteps - first) % timesteps < windowSteps;};
+
+  std::unique_lock<std::mutex> lock(mutex);
+  if (!loadError.empty()) throw std::runtime_error(loadError);
+
+  // pending requests are issued again in the order of the new window, a
+  // step outside of it that is currently loading has to finish first
+  for (Slot* slot : queue) slot->state = SlotState::EMPTY;
+  queue.clear();
+  stateChanged.wait(lock, [&]{
+    return std::none_of(slots.begin(), slots.end(), [&](const Slot& slot) {
+      return slot.state == SlotState::LOADING && !inWindow(slot.timeStep);
+    });
+  });
+
+  for (size_t i = 0;i<windowSteps;++i) {
+    const size_t step = (first + i) % timesteps;
+    if (find(step)) continue;
+    Slot& slot = *std::find_if(slots.begin(), slots.end(), [&](const Slot& slot) {
+      return slot.state == SlotState::EMPTY || !inWindow(slot.timeStep);
+    });
+    slot.timeStep = step;
+    slot.state = SlotState::QUEUED;
+    queue.push_back(&slot);
+  }
+  stateChanged.notify_all();
+
+  stateChanged.wait(lock, [&]{
+    return !loadError.empty() ||
+           (find(first)->state == SlotState::READY && find(second)->state == SlotState::READY);
+  });
+  if (!loadError.empty()) throw std::runtime_error(loadError);
+
+  interval = timeStep;
+  lower = find(first);
+  upper = find(second);
+}
+
+template <typename Format>
+size_t BasicStreamingFlowfield4D<Format>::getMemoryFootprint() const {
+  return slots.size() * slots[0].data.getMemoryFootprint();
+}
+
+template <typename Format>
+size_t BasicStreamingFlowfield4D<Format>::getLoadedCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return loadedCount;
+}
+
+template <typename Format>
+void BasicStreamingFlowfield4D<Format>::run() {
+  std::ifstream file(filename, std::ios::binary);
+  std::vector<float> buffer(3*sizeX*sizeY*sizeZ);
+
+  while (true) {
+    Slot* slot;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stateChanged.wait(lock, [this]{return !queue.empty() || finished;});
+      if (finished) return;
+      slot = queue.front();
+      queue.pop_front();
+      slot->state = SlotState::LOADING;
+    }
+
+    std::string error;
+    try {
+      load(file, buffer, *slot);
+    } catch (const std::runtime_error& e) {
+      error = e.what();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error.empty()) {
+        slot->state = SlotState::READY;
+        ++loadedCount;
+      } else {
+        slot->state = SlotState::EMPTY;
+        loadError = error;
+      }
+    }
+    stateChanged.notify_all();
+  }
+}
+
+template <typename Format>
+void BasicStreamingFlowfield4D<Format>::load(std::ifstream& file, std::vector<float>& buffer, Slot& slot) {
+  const FlowfieldFileHeader header = FlowfieldFileHeader::create(sizeX, sizeY, sizeZ, timesteps);
+  file.clear();
+  file.seekg(std::streamoff(header.getStepOffset(slot.timeStep)));
+  if (!file.read(reinterpret_cast<char*>(buffer.data()), std::streamsize(buffer.size()*sizeof(float)))) {
+    std::stringstream s;
+    s << "Can't read time step " << slot.timeStep << " from file " << filename;
+    throw std::runtime_error(s.str());
+  }
+
+  const size_t count = sizeX*sizeY*sizeZ;
+  for (size_t i = 0;i<count;++i) {
+    slot.data.set(i, Vec3{buffer[i], buffer[count+i], buffer[2*count+i]});
+  }
+}
+
+template <typename Format>
+Vec3 BasicStreamingFlowfield4D<Format>::interpolate(const Vec3& pos, float time) const {
+  const float alpha = std::clamp(time - float(interval), 0.0f, 1.0f);
+  return BasicFlowfield<3, true, Format>::interpolateSteps(lower->data, upper->data, sizeX, sizeY, sizeZ, pos, alpha);
+}
+
+template <typename Format>
+void BasicStreamingFlowfield4D<Format>::interpolateBatch(const float* x, const float* y, const float* z, size_t count,
+                                                         float time, float* resultX, float* resultY, float* resultZ) const {
+  const float alpha = std::clamp(time - float(interval), 0.0f, 1.0f);
+  const float* const positions[3] = {x, y, z};
+  float* const result[3] = {resultX, resultY, resultZ};
+  BasicFlowfield<3, true, Format>::interpolateSteps(lower->data, upper->data, sizeX, sizeY, sizeZ,
+                                             positions, 1, count, alpha, result);
+}
+
+template class BasicStreamingFlowfield4D<Float32>;
+template class BasicStreamingFlowfield4D<Float16>;
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Vec3.h>
+#include <FieldStorage.h>
+
+// Time series in the file format of BasicFlowfield::save of which only
+// a window of windowSize consecutive time steps is held in memory. The
+// integrating thread selects the interval [timeStep, timeStep+1] with
+// setInterval, which waits for these two steps if necessary and queues the
+// rest of the window for a background thread, so the following steps are
+// loaded while the current interval is integrated. As in Flowfield4D
+// the time steps repeat periodically. interpolate may be called from any
+// number of threads but not concurrently with setInterval.
+template <typename Format>
+class BasicStreamingFlowfield4D {
+public:
+  BasicStreamingFlowfield4D(const std::string& filename, size_t windowSize=3);
+  ~BasicStreamingFlowfield4D();
+
+  BasicStreamingFlowfield4D(const BasicStreamingFlowfield4D&) = delete;
+  BasicStreamingFlowfield4D& operator=(const BasicStreamingFlowfield4D&) = delete;
+
+  void setInterval(size_t timeStep);
+  size_t getInterval() const {return interval;}
+
+  // time is clamped to the current interval
+  Vec3 interpolate(const Vec3& pos, float time) const;
+  void interpolateBatch(const float* x, const float* y, const float* z, size_t count, float time,
+                        float* resultX, float* resultY, float* resultZ) const;
+
+  size_t getTimestepCount() const {return timesteps;}
+  size_t getWindowSize() const {return slots.size();}
+  size_t getMemoryFootprint() const;
+  size_t getLoadedCount() const;
+
+private:
+  enum class SlotState {
+    EMPTY,
+    QUEUED,
+    LOADING,
+    READY
+  };
+
+  struct Slot {
+    size_t timeStep{0};
+    SlotState state{SlotState::EMPTY};
+    SoAStorage<Format> data;
+  };
+
+  std::string filename;
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+  size_t timesteps;
+  size_t interval;
+  const Slot* lower;
+  const Slot* upper;
+
+  std::vector<Slot> slots;
+  std::deque<Slot*> queue;
+  mutable std::mutex mutex;
+  std::condition_variable stateChanged;
+  bool finished;
+  size_t loadedCount;
+  std::string loadError;
+  std::thread thread;
+
+  void run();
+  void stop();
+  void load(std::ifstream& file, std::vector<float>& buffer, Slot& slot);
+  Slot* find(size_t timeStep);
+};
+
+typedef BasicStreamingFlowfield4D<Float32> StreamingFlowfield4D;
+typedef BasicStreamingFlowfield4D<Float16> HalfStreamingFlowfield4D;
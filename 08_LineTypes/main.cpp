@@ -2,7 +2,9 @@
 #include <Mat4.h>
 #include <ArcBall.h>
 
-#include "Flowfield4D.h"
+#include "Flowfield.h"
+#include "StreaklineEngine.h"
+#include "StreamingFlowfield4D.h"
 
 class MyGLApp : public GLApp {
 public:
@@ -16,11 +18,21 @@ public:
   double angle{0};
   std::array<std::vector<float>,3> data;
   Flowfield4D flow = Flowfield4D::genDemo(128, {DemoType::SATTLE, DemoType::DRAIN, DemoType::CRITICAL});
+  StreaklineEngine streaklines;
+  std::vector<Vec3> streakPoints;
+  // the demo series written to disk and read back through a window of
+  // time steps, as a stand-in for series too large for memory
+  std::unique_ptr<StreamingFlowfield4D> streamingFlow;
+  bool streaming{false};
 
   void updateTitle() {
     std::stringstream ss;
     const std::array<std::string, 3> names{"Streamlines", "Pathlines", "Streaklines"};
-    ss << "Flow Vis Demo 2 (Curve: " << names[activeLineType] << ")";
+    ss << "Flow Vis Demo 2 (Curve: " << names[activeLineType];
+    if (activeLineType == 2 && streaming) {
+      ss << ", streamed, " << streamingFlow->getLoadedCount() << " steps loaded";
+    }
+    ss << ")";
     glEnv.setTitle(ss.str());
   }
 
@@ -53,7 +65,42 @@ public:
   }
 
   void advectStreak(std::vector<Vec3>& linePoints, double deltaT) {
-    /// TODO: Streakline Advection
+    std::vector<Vec3> seeds(lineCount);
+    for (Vec3& seed : seeds) seed = Vec3::random();
+    streaklines.seed(seeds, lineLength);
+    for (size_t i = 1;i<lineLength;++i) advanceStreaklines(float(deltaT));
+    streaklines.getLinePoints(linePoints);
+  }
+
+  void advanceStreaklines(float deltaT) {
+    if (!streaming) {
+      streaklines.advance(flow, deltaT);
+      return;
+    }
+    // the next steps of the window load while this interval is integrated
+    const size_t step = size_t(streaklines.getTime());
+    if (step != streamingFlow->getInterval()) streamingFlow->setInterval(step);
+    streaklines.advance(*streamingFlow, deltaT);
+  }
+
+  void toggleStreaming() {
+    if (!streamingFlow) {
+      const std::string filename = "demo4d.flow";
+      flow.save(filename);
+      streamingFlow = std::make_unique<StreamingFlowfield4D>(filename);
+    }
+    streaming = !streaming;
+    std::vector<Vec3> linePoints(lineCount*lineLength);
+    advectStreak(linePoints, 0.01f);
+    linePointsToRenderData(linePoints, 2);
+  }
+
+  virtual void animate(double animationTime) override {
+    if (activeLineType != 2) return;
+    advanceStreaklines(0.01f);
+    streaklines.getLinePoints(streakPoints);
+    linePointsToRenderData(streakPoints, 2);
+    if (streaming) updateTitle();
   }
 
   Vec3 advect(const Vec3& particlePos, double t, double deltaT) {
@@ -119,6 +166,10 @@ public:
           activeLineType = (activeLineType+1) % data.size();
           updateTitle();
           break;
+        case GLENV_KEY_S:
+          toggleStreaming();
+          updateTitle();
+          break;
       }
     }
   }
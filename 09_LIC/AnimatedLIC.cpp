@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include <Flowfield.h>
+
+#include "AnimatedLIC.h"
+#include "PixelStreamline.h"
+
+AnimatedLIC::AnimatedLIC(size_t kernelLength, size_t rippleLength, float stepSize) :
+  kernelLength(kernelLength),
+  rippleLength(std::max<size_t>(1, rippleLength)),
+  stepSize(stepSize),
+  width(0),
+  height(0),
+  evaluationCount(0)
+{
+  if (kernelLength > std::numeric_limits<uint16_t>::max()) {
+    std::stringstream s;
+    s << "Kernel length " << kernelLength << " exceeds the maximum of " << std::numeric_limits<uint16_t>::max();
+    throw std::runtime_error(s.str());
+  }
+}
+
+template <typename Field>
+void AnimatedLIC::build(const Field& flow, const Image& noise) {
+  width = noise.width;
+  height = noise.height;
+  setNoise(noise);
+
+  const size_t pixelCount = size_t(width)*size_t(height);
+  std::vector<std::vector<uint32_t>> rowSamples(height);
+  backwardCounts.resize(pixelCount);
+  offsets.resize(pixelCount+1);
+  size_t evaluations = 0;
+
+  #pragma omp parallel reduction(+:evaluations)
+  {
+    std::vector<uint32_t> backward;
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t y = 0;y<int64_t(height);++y) {
+      std::vector<uint32_t>& row = rowSamples[size_t(y)];
+      row.reserve(size_t(width)*(2*kernelLength+1));
+      for (uint32_t x = 0;x<width;++x) {
+        const size_t pixel = x + size_t(y)*width;
+        PixelStreamline<Field> streamline(flow, width, height, stepSize);
+
+        backward.clear();
+        float px = float(x) + 0.5f;
+        float py = float(y) + 0.5f;
+        for (size_t i = 0;i<kernelLength && streamline.step(px, py, -1.0f);++i) {
+          backward.push_back(uint32_t(px) + uint32_t(py)*width);
+        }
+        const size_t first = row.size();
+        row.insert(row.end(), backward.rbegin(), backward.rend());
+        row.push_back(uint32_t(pixel));
+
+        px = float(x) + 0.5f;
+        py = float(y) + 0.5f;
+        for (size_t i = 0;i<kernelLength && streamline.step(px, py, 1.0f);++i) {
+          row.push_back(uint32_t(px) + uint32_t(py)*width);
+        }
+
+        backwardCounts[pixel] = uint16_t(backward.size());
+        offsets[pixel+1] = row.size() - first;
+        evaluations += streamline.getEvaluationCount();
+      }
+    }
+  }
+  evaluationCount = evaluations;
+
+  // per pixel counts to offsets into one contiguous array
+  offsets[0] = 0;
+  for (size_t i = 0;i<pixelCount;++i) offsets[i+1] += offsets[i];
+  samples.resize(offsets[pixelCount]);
+  #pragma omp parallel for
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    std::copy(rowSamples[size_t(y)].begin(), rowSamples[size_t(y)].end(),
+              samples.begin() + std::ptrdiff_t(offsets[size_t(y)*width]));
+  }
+}
+
+void AnimatedLIC::setNoise(const Image& noise) {
+  if (noise.width != width || noise.height != height) {
+    std::stringstream s;
+    s << "Noise of size " << noise.width << "x" << noise.height << " does not match the streamline cache of size "
+      << width << "x" << height;
+    throw std::runtime_error(s.str());
+  }
+  texture.resize(size_t(width)*size_t(height));
+  #pragma omp parallel for
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    for (uint32_t x = 0;x<width;++x) {
+      texture[x + size_t(y)*width] = noise.getLumiValue(x, uint32_t(y)) / 255.0f;
+    }
+  }
+}
+
+void AnimatedLIC::computeWeights(float phase, std::vector<float>& weights, std::vector<float>& prefix) const {
+  constexpr float pi = 3.14159265358979f;
+  const size_t count = 2*kernelLength+1;
+  weights.resize(count);
+  prefix.resize(count+1);
+  prefix[0] = 0.0f;
+  for (size_t i = 0;i<count;++i) {
+    const float s = float(i) - float(kernelLength);
+    const float window = 0.5f + 0.5f * std::cos(pi * s / float(kernelLength+1));
+    const float ripple = 0.5f + 0.5f * std::cos(2.0f * pi * (s / float(rippleLength) + phase));
+    weights[i] = window * ripple;
+    prefix[i+1] = prefix[i] + weights[i];
+  }
+}
+
+void AnimatedLIC::render(float phase, Image& image) const {
+  if (!isBuilt()) throw std::runtime_error("Streamline cache of the animated LIC is not built");
+  if (image.width != width || image.height != height || image.componentCount < 3) image = Image{width, height, 3};
+
+  // the kernel depends only on the offset along the streamline, the
+  // prefix sums normalize it for lines that end before the kernel does
+  std::vector<float> weights, prefix;
+  computeWeights(phase, weights, prefix);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    for (uint32_t x = 0;x<width;++x) {
+      const size_t pixel = x + size_t(y)*width;
+      const uint32_t* pixelSamples = samples.data() + offsets[pixel];
+      const size_t count = offsets[pixel+1] - offsets[pixel];
+      const size_t first = kernelLength - backwardCounts[pixel];
+      const float* pixelWeights = weights.data() + first;
+
+      float sum = 0.0f;
+      for (size_t i = 0;i<count;++i) sum += pixelWeights[i] * texture[pixelSamples[i]];
+      const float norm = prefix[first+count] - prefix[first];
+      image.setNormalizedValue(x, uint32_t(y), norm > 1e-6f ? sum / norm : texture[pixel]);
+    }
+  }
+}
+
+Image AnimatedLIC::render(float phase) const {
+  Image image{width, height, 3};
+  render(phase, image);
+  return image;
+}
+
+size_t AnimatedLIC::getMemoryFootprint() const {
+  return texture.size()*sizeof(float) + samples.size()*sizeof(uint32_t) +
+         offsets.size()*sizeof(size_t) + backwardCounts.size()*sizeof(uint16_t);
+}
+
+template void AnimatedLIC::build<Flowfield2D>(const Flowfield2D& flow, const Image& noise);
+template void AnimatedLIC::build<HalfFlowfield2D>(const HalfFlowfield2D& flow, const Image& noise);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Image.h>
+
+// Animated line integral convolution of a steady 2D field. build traces
+// the streamline of every pixel once (kernelLength samples in each
+// direction, with the integrator of FastLIC) and keeps only the noise
+// pixels it visits. A frame convolves these samples with a Hann window
+// times a periodic ripple shifted by the phase, so every frame is a
+// gather and weighted sum over the cache, parallel over rows. Increasing
+// the phase from 0 to 1 moves the pattern one ripple length downstream,
+// the animation is periodic in the phase.
+class AnimatedLIC {
+public:
+  AnimatedLIC(size_t kernelLength=20, size_t rippleLength=10, float stepSize=0.5f);
+
+  template <typename Field>
+  void build(const Field& flow, const Image& noise);
+  void setNoise(const Image& noise);
+  void render(float phase, Image& image) const;
+  Image render(float phase) const;
+
+  bool isBuilt() const {return !offsets.empty();}
+  uint32_t getWidth() const {return width;}
+  uint32_t getHeight() const {return height;}
+  size_t getSampleCount() const {return samples.size();}
+  size_t getEvaluationCount() const {return evaluationCount;}
+  size_t getMemoryFootprint() const;
+
+private:
+  size_t kernelLength;
+  size_t rippleLength;
+  float stepSize;
+  uint32_t width;
+  uint32_t height;
+  size_t evaluationCount;
+
+  std::vector<float> texture;
+  // the samples of pixel i are samples[offsets[i]] to samples[offsets[i+1]-1]
+  // ordered from the backward to the forward end, backwardCounts[i] of them
+  // precede the pixel itself
+  std::vector<uint32_t> samples;
+  std::vector<size_t> offsets;
+  std::vector<uint16_t> backwardCounts;
+
+  void computeWeights(float phase, std::vector<float>& weights, std::vector<float>& prefix) const;
+};
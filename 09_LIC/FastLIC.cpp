@@ -0,0 +1,143 @@
+#include <algorithm>
+
+#include <Flowfield.h>
+
+#include "FastLIC.h"
+#include "PixelStreamline.h"
+
+FastLIC::FastLIC(const LICSettings& settings) :
+  settings(settings),
+  streamlineCount(0),
+  evaluationCount(0)
+{
+}
+
+template <typename Field>
+size_t FastLIC::integrate(const Field& flow, uint32_t width, uint32_t height, float x, float y, float direction,
+                          size_t maxSamples, std::vector<uint32_t>& pixels, std::vector<float>& values,
+                          bool& truncated) const {
+  PixelStreamline<Field> streamline(flow, width, height, settings.stepSize);
+  truncated = false;
+  for (size_t i = 0;i<maxSamples;++i) {
+    if (!streamline.step(x, y, direction)) return streamline.getEvaluationCount();
+    const uint32_t pixel = uint32_t(x) + uint32_t(y)*width;
+    pixels.push_back(pixel);
+    values.push_back(texture[pixel]);
+  }
+  truncated = true;
+  return streamline.getEvaluationCount();
+}
+
+template <typename Field>
+size_t FastLIC::trace(const Field& flow, uint32_t width, uint32_t height, uint32_t x, uint32_t y, Line& line) {
+  const size_t kernelLength = settings.kernelLength;
+  const size_t maxSamples = std::max(settings.streamlineLength, kernelLength);
+  const float seedX = float(x) + 0.5f;
+  const float seedY = float(y) + 0.5f;
+  const uint32_t seed = x + y*width;
+
+  bool backwardTruncated, forwardTruncated;
+  line.backwardPixels.clear();
+  line.backwardValues.clear();
+  size_t evaluations = integrate(flow, width, height, seedX, seedY, -1.0f, maxSamples,
+                                 line.backwardPixels, line.backwardValues, backwardTruncated);
+
+  line.pixels.assign(line.backwardPixels.rbegin(), line.backwardPixels.rend());
+  line.values.assign(line.backwardValues.rbegin(), line.backwardValues.rend());
+  line.pixels.push_back(seed);
+  line.values.push_back(texture[seed]);
+  evaluations += integrate(flow, width, height, seedX, seedY, 1.0f, maxSamples,
+                           line.pixels, line.values, forwardTruncated);
+
+  // samples closer than kernelLength to an end that was cut off by the
+  // length limit lack part of their kernel and are not deposited, ends at
+  // the border or a critical point are real ends of the streamline
+  const size_t begin = backwardTruncated ? kernelLength : 0;
+  const size_t end = forwardTruncated ? line.pixels.size() - kernelLength : line.pixels.size();
+  deposit(line, begin, end);
+  return evaluations;
+}
+
+void FastLIC::deposit(const Line& line, size_t begin, size_t end) {
+  const size_t kernelLength = settings.kernelLength;
+  const size_t count = line.values.size();
+
+  // box filter over [i-kernelLength, i+kernelLength] clipped to the line,
+  // updated incrementally while sliding along it
+  size_t low = begin > kernelLength ? begin - kernelLength : 0;
+  size_t high = std::min(count, begin + kernelLength + 1);
+  double sum = 0.0;
+  for (size_t j = low;j<high;++j) sum += line.values[j];
+
+  for (size_t i = begin;i<end;++i) {
+    const float value = float(sum / double(high - low));
+    const uint32_t pixel = line.pixels[i];
+    sums[pixel].fetch_add(uint64_t(value * fixedPointScale + 0.5f), std::memory_order_relaxed);
+    hits[pixel].fetch_add(1, std::memory_order_relaxed);
+
+    if (i >= kernelLength) sum -= line.values[low++];
+    if (high < count) sum += line.values[high++];
+  }
+}
+
+template <typename Field>
+Image FastLIC::compute(const Field& flow, const Image& noise) {
+  const uint32_t width = noise.width;
+  const uint32_t height = noise.height;
+  const size_t pixelCount = size_t(width)*size_t(height);
+
+  texture.resize(pixelCount);
+  if (sums.size() != pixelCount) {
+    std::vector<std::atomic<uint64_t>>(pixelCount).swap(sums);
+    std::vector<std::atomic<uint32_t>>(pixelCount).swap(hits);
+  }
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(pixelCount);++i) {
+    texture[size_t(i)] = noise.getLumiValue(uint32_t(size_t(i) % width), uint32_t(size_t(i) / width)) / 255.0f;
+    sums[size_t(i)].store(0, std::memory_order_relaxed);
+    hits[size_t(i)].store(0, std::memory_order_relaxed);
+  }
+
+  const uint32_t tilesX = (width + tileSize - 1) / tileSize;
+  const uint32_t tilesY = (height + tileSize - 1) / tileSize;
+  size_t lines = 0;
+  size_t evaluations = 0;
+
+  #pragma omp parallel reduction(+:lines,evaluations)
+  {
+    Line line;
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t tile = 0;tile<int64_t(tilesX*tilesY);++tile) {
+      const uint32_t startX = uint32_t(tile % tilesX) * tileSize;
+      const uint32_t startY = uint32_t(tile / tilesX) * tileSize;
+      const uint32_t endX = std::min(startX + tileSize, width);
+      const uint32_t endY = std::min(startY + tileSize, height);
+      for (uint32_t y = startY;y<endY;++y) {
+        for (uint32_t x = startX;x<endX;++x) {
+          if (hits[x + y*width].load(std::memory_order_relaxed) >= settings.minHits) continue;
+          evaluations += trace(flow, width, height, x, y, line);
+          ++lines;
+        }
+      }
+    }
+  }
+  streamlineCount = lines;
+  evaluationCount = evaluations;
+
+  Image result{width, height, 3};
+  #pragma omp parallel for
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    for (uint32_t x = 0;x<width;++x) {
+      const size_t pixel = x + size_t(y)*width;
+      const uint32_t count = hits[pixel].load(std::memory_order_relaxed);
+      const float value = count > 0 ? float(sums[pixel].load(std::memory_order_relaxed)) / (fixedPointScale * count)
+                                    : texture[pixel];
+      result.setNormalizedValue(x, uint32_t(y), value);
+    }
+  }
+  return result;
+}
+
+template Image FastLIC::compute<Flowfield2D>(const Flowfield2D& flow, const Image& noise);
+template Image FastLIC::compute<HalfFlowfield2D>(const HalfFlowfield2D& flow, const Image& noise);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <Image.h>
+
+struct LICSettings {
+  size_t kernelLength{20};        // samples on each side of the box filter
+  size_t streamlineLength{300};   // samples per direction of one streamline
+  float stepSize{0.5f};           // in pixels
+  uint32_t minHits{1};            // pixels with fewer hits seed a streamline
+};
+
+// Line integral convolution of a 2D field with the FastLIC scheme: one
+// long streamline is integrated (RK2 along the normalized field, constant
+// step in pixels) and a box filter slides along it, so every streamline
+// contributes to all pixels it crosses. Pixels are visited in tiles, a
+// pixel seeds a new streamline only if fewer than minHits streamlines
+// crossed it so far. The output has the size of the noise image, each
+// pixel is the average of all convolutions deposited in it. Tiles are
+// processed in parallel and deposit with atomic updates.
+class FastLIC {
+public:
+  FastLIC(const LICSettings& settings=LICSettings{});
+
+  template <typename Field>
+  Image compute(const Field& flow, const Image& noise);
+
+  void setSettings(const LICSettings& settings) {this->settings = settings;}
+  const LICSettings& getSettings() const {return settings;}
+
+  size_t getStreamlineCount() const {return streamlineCount;}
+  size_t getEvaluationCount() const {return evaluationCount;}
+
+private:
+  static constexpr uint32_t tileSize = 32;
+  // deposited values are summed in 16.16 fixed point to allow atomic adds
+  static constexpr float fixedPointScale = 65536.0f;
+
+  LICSettings settings;
+  size_t streamlineCount;
+  size_t evaluationCount;
+
+  std::vector<float> texture;
+  std::vector<std::atomic<uint64_t>> sums;
+  std::vector<std::atomic<uint32_t>> hits;
+
+  // the samples of one streamline from its backward to its forward end
+  struct Line {
+    std::vector<uint32_t> pixels;
+    std::vector<float> values;
+    std::vector<uint32_t> backwardPixels;
+    std::vector<float> backwardValues;
+  };
+
+  template <typename Field>
+  size_t trace(const Field& flow, uint32_t width, uint32_t height, uint32_t x, uint32_t y, Line& line);
+  template <typename Field>
+  size_t integrate(const Field& flow, uint32_t width, uint32_t height, float x, float y, float direction,
+                   size_t maxSamples, std::vector<uint32_t>& pixels, std::vector<float>& values,
+                   bool& truncated) const;
+  void deposit(const Line& line, size_t begin, size_t end);
+};
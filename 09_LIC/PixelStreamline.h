@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include <Vec3.h>
+
+// RK2 steps along the normalized field of a 2D flow in the pixel space of
+// a width x height image, every step advances by stepSize pixels no
+// matter the magnitude. Shared by the LIC variants so they all follow
+// exactly the same streamlines.
+template <typename Field>
+class PixelStreamline {
+public:
+  PixelStreamline(const Field& flow, uint32_t width, uint32_t height, float stepSize) :
+    flow(flow),
+    width(float(width)),
+    height(float(height)),
+    stepSize(stepSize),
+    evaluationCount(0)
+  {
+  }
+
+  // advances (x,y) in the given direction (+1 or -1), returns false at
+  // critical points and when the step leaves the image
+  bool step(float& x, float& y, float direction) {
+    float dx, dy;
+    if (!tangent(x, y, direction, dx, dy)) return false;
+    if (!tangent(x + dx*stepSize*0.5f, y + dy*stepSize*0.5f, direction, dx, dy)) return false;
+    x += dx*stepSize;
+    y += dy*stepSize;
+    return x >= 0.0f && y >= 0.0f && x < width && y < height;
+  }
+
+  size_t getEvaluationCount() const {return evaluationCount;}
+
+private:
+  const Field& flow;
+  float width;
+  float height;
+  float stepSize;
+  size_t evaluationCount;
+
+  bool tangent(float x, float y, float direction, float& dx, float& dy) {
+    const Vec3 v = flow.interpolate(Vec3{x / width, y / height, 0.0f});
+    ++evaluationCount;
+    dx = v.x * width;
+    dy = v.y * height;
+    const float length = std::sqrt(dx*dx + dy*dy);
+    if (length < 1e-12f) return false;
+    dx *= direction / length;
+    dy *= direction / length;
+    return true;
+  }
+};
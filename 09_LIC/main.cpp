@@ -1,18 +1,26 @@
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
 #include <GLApp.h>
 #include <bmp.h>
+#include <Flowfield.h>
 
-#include "Flowfield.h"
+#include "FastLIC.h"
+#include "AnimatedLIC.h"
 
 class MyGLApp : public GLApp {
 public:
-  Flowfield flow = Flowfield::genDemo(256, DemoType::SATTLE);
+  Flowfield2D flow = Flowfield2D::genDemo(256, DemoType::SATTLE);
   // this field may be a better start for debugging
-  //Flowfield flow = Flowfield::fromFile("four_sector_128.txt");
+  //Flowfield2D flow = Flowfield2D::fromFile("four_sector_128.txt");
   Image inputImage = BMP::load("noise.bmp");
   Image licImage{uint32_t(flow.getSizeX()),uint32_t(flow.getSizeY()),3};
+  FastLIC lic;
+  AnimatedLIC animatedLIC;
+  bool animated{false};
 
   virtual void init() override {
-    glEnv.setTitle("LIC demo");
     GL(glDisable(GL_CULL_FACE));
     GL(glDisable(GL_DEPTH_TEST));
     GL(glClearColor(0,0,0,0));
@@ -20,10 +28,36 @@ public:
   }
   
   void computeLIC() {
-    // TODO: perform LIC here and store output in licImage
-    licImage = inputImage;
+    const auto start = std::chrono::high_resolution_clock::now();
+    licImage = lic.compute(flow, inputImage);
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
+
+    std::stringstream ss;
+    ss << "LIC demo (FastLIC, " << lic.getStreamlineCount() << " streamlines, "
+       << double(lic.getEvaluationCount()) / (double(licImage.width) * licImage.height)
+       << " evaluations per pixel, " << duration.count() << " ms)";
+    glEnv.setTitle(ss.str());
   }
   
+  void buildAnimation() {
+    const auto start = std::chrono::high_resolution_clock::now();
+    animatedLIC.build(flow, inputImage);
+    const std::chrono::duration<double, std::milli> duration =
+      std::chrono::high_resolution_clock::now() - start;
+
+    std::stringstream ss;
+    ss << "LIC demo (animated, " << animatedLIC.getSampleCount() << " cached samples, "
+       << animatedLIC.getMemoryFootprint() / (1024*1024) << " MB, built in " << duration.count() << " ms)";
+    glEnv.setTitle(ss.str());
+  }
+
+  virtual void animate(double animationTime) override {
+    if (!animated) return;
+    const float phase = float(animationTime - std::floor(animationTime));
+    animatedLIC.render(phase, licImage);
+  }
+
   virtual void draw() override {
     GL(glClear(GL_COLOR_BUFFER_BIT));
     drawImage(licImage);
@@ -35,6 +69,11 @@ public:
         case GLENV_KEY_ESCAPE:
           closeWindow();
           break;
+        case GLENV_KEY_A:
+          animated = !animated;
+          if (animated && !animatedLIC.isBuilt()) buildAnimation();
+          if (!animated) computeLIC();
+          break;
       }
     }
   }
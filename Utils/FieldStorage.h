@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Vec3.h"
+
+// Component formats for SoAStorage, load widens a stored component to a
+// float and store narrows a float to the stored type.
+struct Float32 {
+  typedef float Component;
+  static float load(float v) {return v;}
+  static float store(float v) {return v;}
+};
+
+// IEEE 754 binary16, store rounds to nearest even, overflows become
+// infinity and NaNs stay NaNs
+struct Float16 {
+  typedef uint16_t Component;
+
+  static float load(uint16_t h) {
+    // rescaling the shifted exponent by 2^112 also covers denormals
+    uint32_t bits = uint32_t(h & 0x7FFF) << 13;
+    float f = fromBits(bits) * fromBits(uint32_t(254 - 15) << 23);
+    bits = toBits(f);
+    if (f >= fromBits(uint32_t(127 + 16) << 23)) bits |= uint32_t(255) << 23;
+    return fromBits(bits | (uint32_t(h & 0x8000) << 16));
+  }
+
+  static uint16_t store(float v) {
+    uint32_t bits = toBits(v);
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t h;
+    if (bits >= uint32_t(127 + 16) << 23) {
+      h = bits > uint32_t(255) << 23 ? 0x7E00 : 0x7C00;
+    } else if (bits < uint32_t(113) << 23) {
+      // denormal or zero, the addition rounds the mantissa into place
+      const uint32_t magic = uint32_t((127 - 15) + (23 - 10) + 1) << 23;
+      h = uint16_t(toBits(fromBits(bits) + fromBits(magic)) - magic);
+    } else {
+      const uint32_t odd = (bits >> 13) & 1;
+      bits += (uint32_t(15 - 127) << 23) + 0xFFF + odd;
+      h = uint16_t(bits >> 13);
+    }
+    return uint16_t(h | (sign >> 16));
+  }
+
+private:
+  static uint32_t toBits(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+  }
+
+  static float fromBits(uint32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+  }
+};
+
+// Vector samples stored as one array per component (structure of arrays)
+// in the given format. The format is a template parameter, so a field
+// reading through get is compiled once per format without any per sample
+// dispatch. Fields with fewer than three components (e.g. 2D flow) store
+// only those, get returns zero for the missing ones.
+template <typename Format, size_t Components=3>
+class SoAStorage {
+public:
+  typedef Format FormatType;
+  typedef typename Format::Component Component;
+  static constexpr size_t componentCount = Components;
+
+  void resize(size_t count) {
+    for (std::vector<Component>& c : components) c.resize(count);
+  }
+
+  size_t size() const {return components[0].size();}
+
+  Vec3 get(size_t index) const {
+    Vec3 v{0.0f, 0.0f, 0.0f};
+    for (size_t c = 0;c<Components;++c) v.e[c] = Format::load(components[c][index]);
+    return v;
+  }
+
+  void set(size_t index, const Vec3& v) {
+    for (size_t c = 0;c<Components;++c) components[c][index] = Format::store(v.e[c]);
+  }
+
+  const std::vector<Component>& getComponent(size_t c) const {return components[c];}
+
+  size_t getMemoryFootprint() const {return Components * size() * sizeof(Component);}
+
+private:
+  std::array<std::vector<Component>,Components> components;
+};
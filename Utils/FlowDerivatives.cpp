@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Flowfield.h"
+#include "FlowDerivatives.h"
+
+namespace {
+  // middle eigenvalue of the symmetric matrix with the upper triangle
+  // m00 m01 m02 m11 m12 m22, closed form via the trigonometric solution,
+  // the middle one is the trace minus the largest and the smallest
+  float middleEigenvalue(float m00, float m01, float m02, float m11, float m12, float m22) {
+    const float offDiagonal = m01*m01 + m02*m02 + m12*m12;
+    if (offDiagonal < 1e-20f) {
+      return std::max(std::min(m00, m11), std::min(std::max(m00, m11), m22));
+    }
+    const float q = (m00 + m11 + m22) / 3.0f;
+    const float p = std::sqrt(((m00-q)*(m00-q) + (m11-q)*(m11-q) + (m22-q)*(m22-q) + 2.0f*offDiagonal) / 6.0f);
+    const float b00 = (m00-q)/p, b11 = (m11-q)/p, b22 = (m22-q)/p;
+    const float b01 = m01/p, b02 = m02/p, b12 = m12/p;
+    const float r = 0.5f * (b00*(b11*b22 - b12*b12) - b01*(b01*b22 - b12*b02) + b02*(b01*b12 - b11*b02));
+    const float phi = std::acos(std::clamp(r, -1.0f, 1.0f)) / 3.0f;
+    // cos(phi + 2pi/3) from cos(phi) and sin(phi)
+    const float c = std::cos(phi);
+    const float s = std::sin(phi);
+    const float largest = q + 2.0f*p*c;
+    const float smallest = q + 2.0f*p*(-0.5f*c - 0.8660254f*s);
+    return 3.0f*q - largest - smallest;
+  }
+
+  // all quantities of the Jacobian j (row major, j[3*i+k] = du_i/dx_k)
+  void reduce(const float j[9], float result[4]) {
+    // A = J^2, S^2 + Omega^2 is the symmetric part of A and
+    // |Omega|^2 - |S|^2 = -trace(A)
+    float a[9];
+    for (size_t r = 0;r<3;++r) {
+      for (size_t c = 0;c<3;++c) a[3*r+c] = j[3*r]*j[c] + j[3*r+1]*j[3+c] + j[3*r+2]*j[6+c];
+    }
+    const float curlX = j[7] - j[5];
+    const float curlY = j[2] - j[6];
+    const float curlZ = j[3] - j[1];
+    result[size_t(DerivedQuantity::VORTICITY)] = std::sqrt(curlX*curlX + curlY*curlY + curlZ*curlZ);
+    result[size_t(DerivedQuantity::DIVERGENCE)] = j[0] + j[4] + j[8];
+    result[size_t(DerivedQuantity::Q_CRITERION)] = -0.5f * (a[0] + a[4] + a[8]);
+    result[size_t(DerivedQuantity::LAMBDA2)] = middleEigenvalue(a[0], 0.5f*(a[1]+a[3]), 0.5f*(a[2]+a[6]),
+                                                                a[4], 0.5f*(a[5]+a[7]), a[8]);
+  }
+}
+
+std::string toString(DerivedQuantity quantity) {
+  switch (quantity) {
+    case DerivedQuantity::VORTICITY   : return "vorticity magnitude";
+    case DerivedQuantity::DIVERGENCE  : return "divergence";
+    case DerivedQuantity::Q_CRITERION : return "Q-criterion";
+    case DerivedQuantity::LAMBDA2     : return "lambda2";
+  }
+  return "";
+}
+
+template <typename Field>
+FlowDerivatives::FlowDerivatives(const Field& flow, size_t timeStep) :
+  sizeX(flow.getSizeX()),
+  sizeY(flow.getSizeY()),
+  sizeZ(flow.getSizeZ())
+{
+  typedef typename Field::Storage Storage;
+  typedef typename Storage::Component Component;
+  typedef typename Storage::FormatType Format;
+  const Storage& storage = flow.getStorage(timeStep);
+  for (std::vector<float>& v : values) v.resize(sizeX*sizeY*sizeZ);
+
+  const size_t tilesPerSlice = (sizeY + tileRows - 1) / tileRows;
+  const size_t tileCount = tilesPerSlice*sizeZ;
+  std::vector<float> tileMinimum(tileCount*quantityCount);
+  std::vector<float> tileMaximum(tileCount*quantityCount);
+
+  #pragma omp parallel
+  {
+    // derivatives of one row, gradient[(3*i+k)*sizeX + x] = du_i/dx_k
+    std::vector<float> gradient(9*sizeX);
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t tile = 0;tile<int64_t(tileCount);++tile) {
+      const size_t z = size_t(tile) / tilesPerSlice;
+      const size_t yStart = (size_t(tile) % tilesPerSlice) * tileRows;
+      const size_t yEnd = std::min(yStart + tileRows, sizeY);
+      float* const tileMin = &tileMinimum[size_t(tile)*quantityCount];
+      float* const tileMax = &tileMaximum[size_t(tile)*quantityCount];
+      std::fill(tileMin, tileMin + quantityCount, std::numeric_limits<float>::max());
+      std::fill(tileMax, tileMax + quantityCount, std::numeric_limits<float>::lowest());
+
+      // central differences inside, one sided at the border, a single
+      // layer has no derivative along its axis
+      const size_t zLow = z > 0 ? z-1 : z;
+      const size_t zHigh = std::min(z+1, sizeZ-1);
+      const float scaleZ = zHigh > zLow ? float(sizeZ-1) / float(zHigh-zLow) : 0.0f;
+      const float scaleX = float(sizeX-1);
+
+      for (size_t y = yStart;y<yEnd;++y) {
+        const size_t yLow = y > 0 ? y-1 : y;
+        const size_t yHigh = std::min(y+1, sizeY-1);
+        const float scaleY = yHigh > yLow ? float(sizeY-1) / float(yHigh-yLow) : 0.0f;
+
+        std::fill(gradient.begin(), gradient.end(), 0.0f);
+        for (size_t c = 0;c<Storage::componentCount;++c) {
+          const Component* u = storage.getComponent(c).data();
+          const Component* row = u + (y + z*sizeY)*sizeX;
+          const Component* rowYLow = u + (yLow + z*sizeY)*sizeX;
+          const Component* rowYHigh = u + (yHigh + z*sizeY)*sizeX;
+          const Component* rowZLow = u + (y + zLow*sizeY)*sizeX;
+          const Component* rowZHigh = u + (y + zHigh*sizeY)*sizeX;
+          float* const dx = &gradient[(3*c+0)*sizeX];
+          float* const dy = &gradient[(3*c+1)*sizeX];
+          float* const dz = &gradient[(3*c+2)*sizeX];
+
+          if (sizeX > 1) {
+            dx[0] = (Format::load(row[1]) - Format::load(row[0])) * scaleX;
+            for (size_t x = 1;x+1<sizeX;++x) {
+              dx[x] = (Format::load(row[x+1]) - Format::load(row[x-1])) * (0.5f*scaleX);
+            }
+            dx[sizeX-1] = (Format::load(row[sizeX-1]) - Format::load(row[sizeX-2])) * scaleX;
+          }
+          for (size_t x = 0;x<sizeX;++x) {
+            dy[x] = (Format::load(rowYHigh[x]) - Format::load(rowYLow[x])) * scaleY;
+            dz[x] = (Format::load(rowZHigh[x]) - Format::load(rowZLow[x])) * scaleZ;
+          }
+        }
+
+        const size_t rowStart = (y + z*sizeY)*sizeX;
+        for (size_t x = 0;x<sizeX;++x) {
+          float j[9], result[quantityCount];
+          for (size_t e = 0;e<9;++e) j[e] = gradient[e*sizeX + x];
+          reduce(j, result);
+          for (size_t q = 0;q<quantityCount;++q) {
+            values[q][rowStart + x] = result[q];
+            tileMin[q] = std::min(tileMin[q], result[q]);
+            tileMax[q] = std::max(tileMax[q], result[q]);
+          }
+        }
+      }
+    }
+  }
+
+  for (size_t q = 0;q<quantityCount;++q) {
+    minimum[q] = std::numeric_limits<float>::max();
+    maximum[q] = std::numeric_limits<float>::lowest();
+    for (size_t tile = 0;tile<tileCount;++tile) {
+      minimum[q] = std::min(minimum[q], tileMinimum[tile*quantityCount + q]);
+      maximum[q] = std::max(maximum[q], tileMaximum[tile*quantityCount + q]);
+    }
+  }
+}
+
+template <typename Field>
+Mat3 FlowDerivatives::jacobian(const Field& flow, size_t x, size_t y, size_t z, size_t timeStep) {
+  const size_t size[3] = {flow.getSizeX(), flow.getSizeY(), flow.getSizeZ()};
+  const size_t pos[3] = {x, y, z};
+  std::array<float, 9> j{};
+  for (size_t k = 0;k<3;++k) {
+    size_t low[3] = {x, y, z};
+    size_t high[3] = {x, y, z};
+    low[k] = pos[k] > 0 ? pos[k]-1 : pos[k];
+    high[k] = std::min(pos[k]+1, size[k]-1);
+    if (high[k] == low[k]) continue;
+    const Vec3 d = (flow.getSample(high[0], high[1], high[2], timeStep) -
+                    flow.getSample(low[0], low[1], low[2], timeStep)) *
+                   (float(size[k]-1) / float(high[k]-low[k]));
+    for (size_t i = 0;i<3;++i) j[3*i+k] = d.e[i];
+  }
+  return Mat3{j};
+}
+
+Volume FlowDerivatives::toVolume(DerivedQuantity quantity, float minValue, float maxValue) const {
+  Volume volume;
+  volume.width = sizeX;
+  volume.height = sizeY;
+  volume.depth = sizeZ;
+  volume.scale = Vec3{1.0f, 1.0f, 1.0f};
+  volume.normalizeScale();
+
+  const std::vector<float>& v = values[size_t(quantity)];
+  const float scale = maxValue > minValue ? 1.0f / (maxValue - minValue) : 0.0f;
+  volume.data.resize(v.size());
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(v.size());++i) {
+    volume.data[size_t(i)] = uint8_t(std::clamp((v[size_t(i)] - minValue) * scale, 0.0f, 1.0f) * 255.0f + 0.5f);
+  }
+  return volume;
+}
+
+Volume FlowDerivatives::toVolume(DerivedQuantity quantity) const {
+  if (quantity == DerivedQuantity::VORTICITY) return toVolume(quantity, 0.0f, getMax(quantity));
+  const float range = std::max(std::fabs(getMin(quantity)), std::fabs(getMax(quantity)));
+  return toVolume(quantity, -range, range);
+}
+
+Grid2D FlowDerivatives::toGrid2D(DerivedQuantity quantity, size_t z) const {
+  Grid2D grid(sizeX, sizeY);
+  const std::vector<float>& v = values[size_t(quantity)];
+  for (size_t y = 0;y<sizeY;++y) {
+    for (size_t x = 0;x<sizeX;++x) grid.setValue(x, y, v[x + (y + z*sizeY)*sizeX]);
+  }
+  return grid;
+}
+
+#define INSTANTIATE_FLOW_DERIVATIVES(FIELD)                                                             \
+  template FlowDerivatives::FlowDerivatives<FIELD>(const FIELD& flow, size_t timeStep);                 \
+  template Mat3 FlowDerivatives::jacobian<FIELD>(const FIELD& flow, size_t x, size_t y, size_t z,      \
+                                                 size_t timeStep);
+
+INSTANTIATE_FLOW_DERIVATIVES(Flowfield)
+INSTANTIATE_FLOW_DERIVATIVES(HalfFlowfield)
+INSTANTIATE_FLOW_DERIVATIVES(Flowfield2D)
+INSTANTIATE_FLOW_DERIVATIVES(HalfFlowfield2D)
+INSTANTIATE_FLOW_DERIVATIVES(Flowfield4D)
+INSTANTIATE_FLOW_DERIVATIVES(HalfFlowfield4D)
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "Mat3.h"
+#include "Grid2D.h"
+#include "Volume.h"
+
+enum class DerivedQuantity {
+  VORTICITY,    // magnitude of the curl
+  DIVERGENCE,
+  Q_CRITERION,  // 0.5 (|Omega|^2 - |S|^2), positive in vortices
+  LAMBDA2       // middle eigenvalue of S^2 + Omega^2, negative in vortices
+};
+
+std::string toString(DerivedQuantity quantity);
+
+// Scalar quantities derived from the velocity gradient of one time step
+// of a flow field, all computed at the grid vertices in a single pass.
+// The Jacobian uses central differences in [0,1]^3 coordinates (one
+// sided at the border) and is reduced to all quantities right away, so
+// it is never stored. The pass runs in parallel over tiles of rows that
+// share their neighboring rows in cache. 2D fields are treated as 3D
+// fields without z component and z derivatives. The results are kept
+// for any number of exports.
+class FlowDerivatives {
+public:
+  template <typename Field>
+  FlowDerivatives(const Field& flow, size_t timeStep=0);
+
+  // the velocity gradient at one vertex, entry (i,j) is du_i/dx_j
+  template <typename Field>
+  static Mat3 jacobian(const Field& flow, size_t x, size_t y, size_t z=0, size_t timeStep=0);
+
+  const std::vector<float>& getValues(DerivedQuantity quantity) const {return values[size_t(quantity)];}
+  float getMin(DerivedQuantity quantity) const {return minimum[size_t(quantity)];}
+  float getMax(DerivedQuantity quantity) const {return maximum[size_t(quantity)];}
+
+  // maps [minValue, maxValue] to [0, 255]
+  Volume toVolume(DerivedQuantity quantity, float minValue, float maxValue) const;
+  // maps the value range, signed quantities symmetric around 0 so that 0
+  // becomes 128 and is a meaningful isovalue
+  Volume toVolume(DerivedQuantity quantity) const;
+  Grid2D toGrid2D(DerivedQuantity quantity, size_t z=0) const;
+
+  size_t getSizeX() const {return sizeX;}
+  size_t getSizeY() const {return sizeY;}
+  size_t getSizeZ() const {return sizeZ;}
+
+private:
+  static constexpr size_t quantityCount = 4;
+  static constexpr size_t tileRows = 8;
+
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+  std::array<std::vector<float>, quantityCount> values;
+  std::array<float, quantityCount> minimum;
+  std::array<float, quantityCount> maximum;
+};
@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "Flowfield.h"
+
+static const char fileMagic[8] = {'F','L','O','W','F','L','D','2'};
+
+FlowfieldFileHeader FlowfieldFileHeader::create(size_t sizeX, size_t sizeY, size_t sizeZ, size_t timesteps) {
+  FlowfieldFileHeader header;
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.sizeX = sizeX;
+  header.sizeY = sizeY;
+  header.sizeZ = sizeZ;
+  header.timesteps = timesteps;
+  header.sourceSize = 0;
+  header.sourceTime = 0;
+  header.sourceTimesteps = 0;
+  return header;
+}
+
+bool FlowfieldFileHeader::isValid() const {
+  return std::memcmp(magic, fileMagic, sizeof(fileMagic)) == 0 &&
+         sizeX > 0 && sizeY > 0 && sizeZ > 0 && timesteps > 0;
+}
+
+uint64_t FlowfieldFileHeader::getStepOffset(size_t timeStep) const {
+  return sizeof(FlowfieldFileHeader) + uint64_t(timeStep) * 3 * getSampleCount() * sizeof(float);
+}
+
+static Vec3 demoSample(DemoType d, float localX, float localY, float localZ) {
+  switch (d) {
+    case DemoType::DRAIN :
+      return Vec3{(-localY+0.5f)+(0.5f-localX)/10.0f,(localX-0.5f)+(0.5f-localY)/10.0f,-localZ/10.0f};
+    case DemoType::SATTLE :
+      return Vec3{0.5f-localX,localY-0.5f,0.5f-localZ};
+    case DemoType::CRITICAL :
+      return Vec3{(localX-0.1f)*(localY-0.3f)*(localX-0.8f),(localY-0.7f)*(localZ-0.2f)*(localX-0.3f),(localZ-0.9f)*(localZ-0.6f)*(localX-0.5f)};
+  }
+  return Vec3{0,0,0};
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+BasicFlowfield<Dimensions, TimeDependent, Format>
+BasicFlowfield<Dimensions, TimeDependent, Format>::genDemo(size_t size, const std::vector<DemoType>& d) {
+  const size_t sizeZ = Dimensions == 3 ? size : 1;
+  BasicFlowfield f{size, size, sizeZ, d.size()};
+
+  for (size_t ts = 0;ts<f.data.size();++ts) {
+    for (size_t z = 0;z<sizeZ;++z) {
+      const float localZ = float(z)/size;
+      for (size_t y = 0;y<size;++y) {
+        const float localY = float(y)/size;
+        for (size_t x = 0;x<size;++x) {
+          const float localX = float(x)/size;
+          f.data[ts].set(x+y*size+z*size*size, demoSample(d[ts], localX, localY, localZ));
+        }
+      }
+    }
+  }
+
+  return f;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+BasicFlowfield<Dimensions, TimeDependent, Format>
+BasicFlowfield<Dimensions, TimeDependent, Format>::genDemo(size_t size, DemoType d) {
+  return genDemo(size, std::vector<DemoType>{d});
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+BasicFlowfield<Dimensions, TimeDependent, Format>::BasicFlowfield(size_t sizeX, size_t sizeY, size_t sizeZ,
+                                                                  size_t timesteps) :
+sizeX(sizeX),
+sizeY(sizeY),
+sizeZ(Dimensions == 3 ? sizeZ : 1)
+{
+  data.resize(TimeDependent ? std::max<size_t>(1, timesteps) : 1);
+  for (Storage& step : data) step.resize(sizeX*sizeY*this->sizeZ);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+size_t BasicFlowfield<Dimensions, TimeDependent, Format>::getMemoryFootprint() const {
+  size_t footprint = 0;
+  for (const Storage& step : data) footprint += step.getMemoryFootprint();
+  return footprint;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+Vec3 BasicFlowfield<Dimensions, TimeDependent, Format>::getSample(size_t x, size_t y, size_t z,
+                                                                  size_t timeStep) const {
+  return data[timeStep % data.size()].get(x+y*sizeX+z*sizeX*sizeY);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::setSample(size_t x, size_t y, size_t z, const Vec3& v,
+                                                                  size_t timeStep) {
+  data[timeStep % data.size()].set(x+y*sizeX+z*sizeX*sizeY, v);
+}
+
+static float mix(float a, float b, float alpha) {
+  return a * (1.0f - alpha) + b * alpha;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::findSteps(float time, size_t& first, size_t& second,
+                                                                  float& alpha) const {
+  if constexpr (TimeDependent) {
+    const float floorTime = std::floor(time);
+    first = size_t(floorTime) % data.size();
+    second = (first + 1) % data.size();
+    alpha = time - floorTime;
+  } else {
+    first = second = 0;
+    alpha = 0.0f;
+  }
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+Vec3 BasicFlowfield<Dimensions, TimeDependent, Format>::interpolate(const Vec3& pos, float time) const {
+  size_t first, second;
+  float alpha;
+  findSteps(time, first, second, alpha);
+  return interpolateSteps(data[first], data[second], sizeX, sizeY, sizeZ, pos, alpha);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateBatch(const float* x, const float* y, const float* z,
+                                                                         size_t count, float* resultX, float* resultY,
+                                                                         float* resultZ, bool presorted) const {
+  interpolateBatch(x, y, z, count, 0.0f, resultX, resultY, resultZ, presorted);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateBatch(const float* x, const float* y, const float* z,
+                                                                         size_t count, float time, float* resultX,
+                                                                         float* resultY, float* resultZ,
+                                                                         bool presorted) const {
+  size_t first, second;
+  float alpha;
+  findSteps(time, first, second, alpha);
+  const float* const positions[3] = {x, y, z};
+  float* const result[3] = {resultX, resultY, resultZ};
+  interpolateSteps(data[first], data[second], sizeX, sizeY, sizeZ, positions, 1, count, alpha, result, presorted);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateBatch(const std::vector<Vec3>& positions,
+                                                                         std::vector<Vec3>& result) const {
+  interpolateBatch(positions, 0.0f, result);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateBatch(const std::vector<Vec3>& positions, float time,
+                                                                         std::vector<Vec3>& result) const {
+  result.resize(positions.size());
+  if (positions.empty()) return;
+  size_t first, second;
+  float alpha;
+  findSteps(time, first, second, alpha);
+  const float* const pos[3] = {&positions[0].x, &positions[0].y, &positions[0].z};
+  float* const res[3] = {&result[0].x, &result[0].y, &result[0].z};
+  interpolateSteps(data[first], data[second], sizeX, sizeY, sizeZ,
+                   pos, sizeof(Vec3)/sizeof(float), positions.size(), alpha, res);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+Vec3 BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateSteps(const Storage& first, const Storage& second,
+                                                                         size_t sizeX, size_t sizeY, size_t sizeZ,
+                                                                         const Vec3& pos, float alpha) {
+  // one floor per axis, the upper corner is clamped to the last sample
+  const size_t size[3] = {sizeX, sizeY, sizeZ};
+  const size_t axisStride[3] = {1, sizeX, sizeX*sizeY};
+  size_t base = 0;
+  std::array<size_t, 3> delta;
+  std::array<float, 3> weight;
+  for (size_t a = 0;a<Dimensions;++a) {
+    const float g = std::clamp(pos.e[a], 0.0f, 1.0f) * float(size[a]-1);
+    const size_t cell = size_t(g);
+    weight[a] = g - float(cell);
+    delta[a] = cell+1 < size[a] ? axisStride[a] : 0;
+    base += cell * axisStride[a];
+  }
+
+  Vec3 result{0.0f, 0.0f, 0.0f};
+  for (size_t c = 0;c<Dimensions;++c) {
+    const typename Format::Component* u = first.getComponent(c).data();
+    const typename Format::Component* v = second.getComponent(c).data();
+    auto load = [&](size_t index) {
+      if constexpr (TimeDependent)
+        return mix(Format::load(u[index]), Format::load(v[index]), alpha);
+      else
+        return Format::load(u[index]);
+    };
+
+    const float c0 = mix(mix(load(base), load(base+delta[0]), weight[0]),
+                         mix(load(base+delta[1]), load(base+delta[1]+delta[0]), weight[0]),
+                         weight[1]);
+    if constexpr (Dimensions == 2) {
+      result.e[c] = c0;
+    } else {
+      const size_t top = base+delta[2];
+      const float c1 = mix(mix(load(top), load(top+delta[0]), weight[0]),
+                           mix(load(top+delta[1]), load(top+delta[1]+delta[0]), weight[0]),
+                           weight[1]);
+      result.e[c] = mix(c0, c1, weight[2]);
+    }
+  }
+  return result;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+std::vector<uint32_t> BasicFlowfield<Dimensions, TimeDependent, Format>::sortByBrick(const size_t size[3],
+                                                                                     const float* const positions[3],
+                                                                                     size_t stride, size_t count) {
+  size_t bricks[3] = {1, 1, 1};
+  for (size_t a = 0;a<Dimensions;++a) bricks[a] = (size[a]-1) / batchBrickSize + 1;
+
+  std::vector<uint32_t> keys(count);
+  for (size_t i = 0;i<count;++i) {
+    size_t key = 0;
+    for (size_t a = Dimensions;a-->0;) {
+      const float g = std::clamp(positions[a][i*stride], 0.0f, 1.0f) * float(size[a]-1);
+      key = key * bricks[a] + size_t(g) / batchBrickSize;
+    }
+    keys[i] = uint32_t(key);
+  }
+
+  // counting sort, stable so queries within a brick keep their order
+  std::vector<uint32_t> offsets(bricks[0]*bricks[1]*bricks[2]+1, 0);
+  for (uint32_t key : keys) ++offsets[key+1];
+  for (size_t b = 1;b<offsets.size();++b) offsets[b] += offsets[b-1];
+  std::vector<uint32_t> order(count);
+  for (size_t i = 0;i<count;++i) order[offsets[keys[i]]++] = uint32_t(i);
+  return order;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::interpolateSteps(const Storage& first, const Storage& second,
+                                                                         size_t sizeX, size_t sizeY, size_t sizeZ,
+                                                                         const float* const positions[3], size_t stride,
+                                                                         size_t count, float alpha,
+                                                                         float* const result[3], bool presorted) {
+  const size_t size[3] = {sizeX, sizeY, sizeZ};
+  std::vector<uint32_t> order;
+  if (!presorted && count >= minSortedBatch) order = sortByBrick(size, positions, stride, count);
+
+  const float last[3] = {float(sizeX-1), float(sizeY-1), float(sizeZ-1)};
+  const uint32_t axisStride[3] = {1, uint32_t(sizeX), uint32_t(sizeX*sizeY)};
+
+  // the queries are processed in blocks, first the cell indices, weights
+  // and corner offsets of the whole block in loops without dependencies
+  // that the compiler can vectorize, then the gathers
+  std::array<uint32_t, batchBlockSize> query;
+  std::array<uint32_t, batchBlockSize> base;
+  std::array<std::array<float, batchBlockSize>, Dimensions> weight;
+  std::array<std::array<uint32_t, batchBlockSize>, Dimensions> offset;
+  for (size_t start = 0;start<count;start+=batchBlockSize) {
+    const size_t blockSize = std::min(batchBlockSize, count-start);
+    for (size_t i = 0;i<blockSize;++i) {
+      query[i] = order.empty() ? uint32_t(start+i) : order[start+i];
+    }
+
+    std::fill(base.begin(), base.end(), 0);
+    for (size_t a = 0;a<Dimensions;++a) {
+      for (size_t i = 0;i<blockSize;++i) {
+        const float g = std::clamp(positions[a][query[i]*stride], 0.0f, 1.0f) * last[a];
+        const uint32_t cell = uint32_t(g);
+        weight[a][i] = g - float(cell);
+        offset[a][i] = float(cell) < last[a] ? axisStride[a] : 0;
+        base[i] += cell * axisStride[a];
+      }
+    }
+
+    for (size_t c = 0;c<Dimensions;++c) {
+      const typename Format::Component* u = first.getComponent(c).data();
+      const typename Format::Component* v = second.getComponent(c).data();
+      auto load = [&](uint32_t index) {
+        if constexpr (TimeDependent)
+          return mix(Format::load(u[index]), Format::load(v[index]), alpha);
+        else
+          return Format::load(u[index]);
+      };
+
+      for (size_t i = 0;i<blockSize;++i) {
+        const uint32_t i00 = base[i];
+        const uint32_t i10 = i00 + offset[0][i];
+        const uint32_t i01 = i00 + offset[1][i];
+        const uint32_t i11 = i01 + offset[0][i];
+        const float c0 = mix(mix(load(i00), load(i10), weight[0][i]),
+                             mix(load(i01), load(i11), weight[0][i]),
+                             weight[1][i]);
+        if constexpr (Dimensions == 2) {
+          result[c][query[i]*stride] = c0;
+        } else {
+          const uint32_t dZ = offset[2][i];
+          const float c1 = mix(mix(load(i00+dZ), load(i10+dZ), weight[0][i]),
+                               mix(load(i01+dZ), load(i11+dZ), weight[0][i]),
+                               weight[1][i]);
+          result[c][query[i]*stride] = mix(c0, c1, weight[2][i]);
+        }
+      }
+    }
+
+    if constexpr (Dimensions == 2) {
+      for (size_t i = 0;i<blockSize;++i) result[2][query[i]*stride] = 0.0f;
+    }
+  }
+}
+
+template class BasicFlowfield<2, false, Float32>;
+template class BasicFlowfield<2, false, Float16>;
+template class BasicFlowfield<3, false, Float32>;
+template class BasicFlowfield<3, false, Float16>;
+template class BasicFlowfield<2, true, Float32>;
+template class BasicFlowfield<2, true, Float16>;
+template class BasicFlowfield<3, true, Float32>;
+template class BasicFlowfield<3, true, Float16>;
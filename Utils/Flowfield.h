@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vec3.h"
+#include "FieldStorage.h"
+
+enum class DemoType {
+  DRAIN,
+  SATTLE,
+  CRITICAL
+};
+
+// Header of the binary files written by BasicFlowfield::save and of the
+// caches of BasicFlowfield::fromFile, it is followed by the x, y and z
+// components of every time step as blocks of 32 bit floats. For caches
+// source size, time and time step count identify the text file they were
+// created from.
+struct FlowfieldFileHeader {
+  char magic[8];
+  uint64_t sizeX;
+  uint64_t sizeY;
+  uint64_t sizeZ;
+  uint64_t timesteps;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  uint64_t sourceTimesteps;
+
+  static FlowfieldFileHeader create(size_t sizeX, size_t sizeY, size_t sizeZ, size_t timesteps);
+  bool isValid() const;
+  uint64_t getSampleCount() const {return sizeX*sizeY*sizeZ;}
+  uint64_t getStepOffset(size_t timeStep) const;
+};
+
+// Regular vector field on [0,1]^Dimensions, 2D fields store and gather
+// only two components of four corners. A time dependent field holds a
+// periodic series of time steps and interpolates linearly between them,
+// a steady field has a single step and ignores the time arguments. The
+// storage format (Float32 or Float16) is a template parameter as well, so
+// every combination is compiled without per sample branches. Positions
+// and results are Vec3 in both cases, 2D fields ignore z and return 0.
+template <size_t Dimensions, bool TimeDependent, typename Format>
+class BasicFlowfield {
+  static_assert(Dimensions == 2 || Dimensions == 3, "flow fields are 2D or 3D");
+public:
+  typedef SoAStorage<Format, Dimensions> Storage;
+
+  BasicFlowfield(size_t sizeX, size_t sizeY, size_t sizeZ=1, size_t timesteps=1);
+
+  Vec3 interpolate(const Vec3& pos, float time=0.0f) const;
+  // interpolates count positions at the same time given as separate
+  // coordinate arrays, large batches are processed in the order of their
+  // bricks for locality unless the caller already sorted them spatially
+  void interpolateBatch(const float* x, const float* y, const float* z, size_t count,
+                        float* resultX, float* resultY, float* resultZ, bool presorted=false) const;
+  void interpolateBatch(const float* x, const float* y, const float* z, size_t count, float time,
+                        float* resultX, float* resultY, float* resultZ, bool presorted=false) const;
+  void interpolateBatch(const std::vector<Vec3>& positions, std::vector<Vec3>& result) const;
+  void interpolateBatch(const std::vector<Vec3>& positions, float time, std::vector<Vec3>& result) const;
+
+  Vec3 getSample(size_t x, size_t y, size_t z=0, size_t timeStep=0) const;
+  void setSample(size_t x, size_t y, size_t z, const Vec3& v, size_t timeStep=0);
+
+  size_t getSizeX() const {return sizeX;}
+  size_t getSizeY() const {return sizeY;}
+  size_t getSizeZ() const {return sizeZ;}
+  size_t getTimestepCount() const {return data.size();}
+  size_t getMemoryFootprint() const;
+  const Storage& getStorage(size_t timeStep=0) const {return data[timeStep % data.size()];}
+
+  // one time step per entry of d, steady fields use the first one
+  static BasicFlowfield genDemo(size_t size, const std::vector<DemoType>& d);
+  static BasicFlowfield genDemo(size_t size, DemoType d);
+  // reads the comma separated text format (steady fields read the first
+  // time step), the parsed field is stored in a binary cache next to the
+  // file that is used while the file is unchanged
+  static BasicFlowfield fromFile(const std::string& filename, bool useCache=true);
+  void save(const std::string& filename) const;
+
+  // interpolation between the time steps first (alpha = 0) and second
+  // (alpha = 1) of a grid of the given size, the cell and its weights are
+  // computed once for all corners of both steps
+  static Vec3 interpolateSteps(const Storage& first, const Storage& second,
+                               size_t sizeX, size_t sizeY, size_t sizeZ, const Vec3& pos, float alpha);
+  static void interpolateSteps(const Storage& first, const Storage& second,
+                               size_t sizeX, size_t sizeY, size_t sizeZ,
+                               const float* const positions[3], size_t stride, size_t count, float alpha,
+                               float* const result[3], bool presorted=false);
+
+private:
+  static constexpr size_t batchBlockSize = 64;
+  static constexpr size_t batchBrickSize = 8;
+  static constexpr size_t minSortedBatch = 4096;
+
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+  std::vector<Storage> data;
+
+  void findSteps(float time, size_t& first, size_t& second, float& alpha) const;
+  static std::vector<uint32_t> sortByBrick(const size_t size[3], const float* const positions[3],
+                                           size_t stride, size_t count);
+
+  static bool loadCache(const std::string& filename, uint64_t sourceSize, int64_t sourceTime,
+                        BasicFlowfield& field);
+  bool saveFile(const std::string& filename, const FlowfieldFileHeader& header) const;
+};
+
+typedef BasicFlowfield<3, false, Float32> Flowfield;
+typedef BasicFlowfield<3, false, Float16> HalfFlowfield;
+typedef BasicFlowfield<2, false, Float32> Flowfield2D;
+typedef BasicFlowfield<2, false, Float16> HalfFlowfield2D;
+typedef BasicFlowfield<3, true, Float32> Flowfield4D;
+typedef BasicFlowfield<3, true, Float16> HalfFlowfield4D;
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "Flowfield.h"
+#include "MappedFile.h"
+
+namespace {
+  // text chunks are about this large and parsed in parallel
+  const size_t parseChunkSize = size_t(1) << 20;
+
+  bool isSeparator(char c) {
+    return c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  bool parseFloat(const char* first, const char* last, float& value) {
+    if (first != last && *first == '+') ++first;
+#if defined(__cpp_lib_to_chars)
+    const std::from_chars_result result = std::from_chars(first, last, value);
+    return result.ec == std::errc() && result.ptr == last;
+#else
+    // without floating point from_chars the token is terminated in a copy
+    char buffer[64];
+    const size_t length = size_t(last - first);
+    if (length == 0 || length >= sizeof(buffer)) return false;
+    std::copy(first, last, buffer);
+    buffer[length] = 0;
+    char* parsedEnd;
+    value = std::strtof(buffer, &parsedEnd);
+    return parsedEnd == buffer + length;
+#endif
+  }
+
+  // parses the next integer and advances current behind it
+  size_t parseSize(const char*& current, const char* end, const std::string& filename) {
+    while (current < end && isSeparator(*current)) ++current;
+    const char* tokenEnd = current;
+    while (tokenEnd < end && !isSeparator(*tokenEnd)) ++tokenEnd;
+
+    long long value = 0;
+    const std::from_chars_result result = std::from_chars(current, tokenEnd, value);
+    if (result.ec != std::errc() || result.ptr != tokenEnd || value < 0) {
+      std::stringstream s;
+      s << "Invalid header in file " << filename;
+      throw std::runtime_error(s.str());
+    }
+    current = tokenEnd;
+    return size_t(value);
+  }
+
+  // parses count values from [begin,end), the text is split into chunks
+  // at separators; a first pass counts the tokens of every chunk, so the
+  // second pass knows where each chunk has to store its values
+  std::vector<float> parseValues(const char* begin, const char* end, size_t count,
+                                 const std::string& filename) {
+    const size_t chunkCount = size_t(end - begin) / parseChunkSize + 1;
+    std::vector<const char*> bounds(chunkCount+1, end);
+    bounds[0] = begin;
+    for (size_t i = 1;i<chunkCount;++i) {
+      const char* bound = std::max(bounds[i-1], begin + i * parseChunkSize);
+      while (bound < end && !isSeparator(bound[-1])) ++bound;
+      bounds[i] = bound;
+    }
+
+    std::vector<size_t> firstToken(chunkCount+1, 0);
+    #pragma omp parallel for
+    for (int64_t i = 0;i<int64_t(chunkCount);++i) {
+      size_t tokens = 0;
+      bool previousSeparator = true;
+      for (const char* c = bounds[size_t(i)];c<bounds[size_t(i)+1];++c) {
+        const bool separator = isSeparator(*c);
+        if (!separator && previousSeparator) ++tokens;
+        previousSeparator = separator;
+      }
+      firstToken[size_t(i)+1] = tokens;
+    }
+    for (size_t i = 0;i<chunkCount;++i) firstToken[i+1] += firstToken[i];
+
+    if (firstToken.back() < count) {
+      std::stringstream s;
+      s << "Unexpected end of file " << filename;
+      throw std::runtime_error(s.str());
+    }
+
+    std::vector<float> values(count);
+    bool valid = true;
+    #pragma omp parallel for reduction(&&:valid)
+    for (int64_t i = 0;i<int64_t(chunkCount);++i) {
+      size_t index = firstToken[size_t(i)];
+      const char* c = bounds[size_t(i)];
+      const char* chunkEnd = bounds[size_t(i)+1];
+      while (index < count) {
+        while (c < chunkEnd && isSeparator(*c)) ++c;
+        if (c == chunkEnd) break;
+        const char* tokenEnd = c;
+        while (tokenEnd < end && !isSeparator(*tokenEnd)) ++tokenEnd;
+        if (!parseFloat(c, tokenEnd, values[index++])) valid = false;
+        c = tokenEnd;
+      }
+    }
+
+    if (!valid) {
+      std::stringstream s;
+      s << "Invalid value in file " << filename;
+      throw std::runtime_error(s.str());
+    }
+    return values;
+  }
+
+  struct SourceStamp {
+    uint64_t size;
+    int64_t time;
+  };
+
+  SourceStamp getSourceStamp(const std::string& filename) {
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(filename, error);
+    if (error) {
+      std::stringstream s;
+      s << "Can't open file " << filename;
+      throw std::runtime_error(s.str());
+    }
+    const std::filesystem::file_time_type time = std::filesystem::last_write_time(filename, error);
+    return {uint64_t(size), error ? 0 : int64_t(time.time_since_epoch().count())};
+  }
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+bool BasicFlowfield<Dimensions, TimeDependent, Format>::loadCache(const std::string& filename, uint64_t sourceSize,
+                                                                  int64_t sourceTime, BasicFlowfield& field) {
+  std::unique_ptr<MappedFile> cache;
+  try {
+    cache = std::make_unique<MappedFile>(filename);
+  } catch (const std::runtime_error&) {
+    return false;
+  }
+  if (cache->size() < sizeof(FlowfieldFileHeader)) return false;
+
+  FlowfieldFileHeader header;
+  std::memcpy(&header, cache->data(), sizeof(header));
+  if (!header.isValid() || header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+      cache->size() != header.getStepOffset(size_t(header.timesteps))) return false;
+
+  // a steady field only needs the first step, a time dependent one all of
+  // them, a 2D field can not be read from a 3D grid
+  if (TimeDependent && header.timesteps != header.sourceTimesteps) return false;
+  if (Dimensions == 2 && header.sizeZ != 1) return false;
+
+  field = BasicFlowfield{size_t(header.sizeX), size_t(header.sizeY), size_t(header.sizeZ), size_t(header.timesteps)};
+  const size_t sampleCount = size_t(header.getSampleCount());
+  for (size_t ts = 0;ts<field.data.size();++ts) {
+    const char* block = cache->data() + header.getStepOffset(ts);
+    Storage& step = field.data[ts];
+    #pragma omp parallel for
+    for (int64_t i = 0;i<int64_t(sampleCount);++i) {
+      Vec3 v;
+      for (size_t c = 0;c<3;++c) {
+        std::memcpy(&v.e[c], block + (c * sampleCount + size_t(i)) * sizeof(float), sizeof(float));
+      }
+      step.set(size_t(i), v);
+    }
+  }
+  return true;
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+bool BasicFlowfield<Dimensions, TimeDependent, Format>::saveFile(const std::string& filename,
+                                                                 const FlowfieldFileHeader& header) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file) return false;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::vector<float> component(sizeX*sizeY*sizeZ);
+  for (const Storage& step : data) {
+    for (size_t c = 0;c<3;++c) {
+      for (size_t i = 0;i<component.size();++i) component[i] = step.get(i).e[c];
+      file.write(reinterpret_cast<const char*>(component.data()), std::streamsize(component.size()*sizeof(float)));
+    }
+  }
+  // a partially written cache is rejected by its size on the next load
+  return bool(file);
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+void BasicFlowfield<Dimensions, TimeDependent, Format>::save(const std::string& filename) const {
+  if (!saveFile(filename, FlowfieldFileHeader::create(sizeX, sizeY, sizeZ, data.size()))) {
+    std::stringstream s;
+    s << "Can't write file " << filename;
+    throw std::runtime_error(s.str());
+  }
+}
+
+template <size_t Dimensions, bool TimeDependent, typename Format>
+BasicFlowfield<Dimensions, TimeDependent, Format> BasicFlowfield<Dimensions, TimeDependent, Format>::fromFile(const std::string& filename, bool useCache) {
+  const SourceStamp stamp = getSourceStamp(filename);
+  const std::string cacheFilename = filename + ".cache";
+
+  BasicFlowfield f{1,1,1};
+  if (useCache && loadCache(cacheFilename, stamp.size, stamp.time, f)) return f;
+
+  const MappedFile file(filename);
+  const char* current = file.data();
+  const char* end = file.data() + file.size();
+
+  const size_t dims = parseSize(current, end, filename);
+  if (dims < 1 || dims > Dimensions) {
+    std::stringstream s;
+    s << "Invalid dimenion " << dims;
+    throw std::runtime_error(s.str());
+  }
+  
+  size_t size[3] = {1, 1, 1};
+  for (size_t d = 0;d<dims;++d) size[d] = parseSize(current, end, filename);
+  
+  const size_t timesteps = parseSize(current, end, filename);
+  if (timesteps < 1) {
+    std::stringstream s;
+    s << "Invalid timesteps " << timesteps;
+    throw std::runtime_error(s.str());
+  }
+
+  // the samples hold dims components, the time steps follow each other
+  const size_t stepCount = TimeDependent ? timesteps : 1;
+  const size_t sampleCount = size[0]*size[1]*size[2];
+  const std::vector<float> values = parseValues(current, end, stepCount*sampleCount*dims, filename);
+
+  f = BasicFlowfield{size[0], size[1], size[2], stepCount};
+  for (size_t ts = 0;ts<stepCount;++ts) {
+    const float* stepValues = values.data() + ts*sampleCount*dims;
+    Storage& step = f.data[ts];
+    #pragma omp parallel for
+    for (int64_t i = 0;i<int64_t(sampleCount);++i) {
+      Vec3 v{0,0,0};
+      for (size_t d = 0;d<dims;++d) v.e[d] = stepValues[size_t(i)*dims+d];
+      step.set(size_t(i), v);
+    }
+  }
+
+  if (useCache) {
+    FlowfieldFileHeader header = FlowfieldFileHeader::create(size[0], size[1], size[2], stepCount);
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.sourceTimesteps = timesteps;
+    f.saveFile(cacheFilename, header);
+  }
+  return f;
+}
+
+#define INSTANTIATE_FLOWFIELD_IO(D, T, F) \
+  template BasicFlowfield<D, T, F> BasicFlowfield<D, T, F>::fromFile(const std::string& filename, bool useCache); \
+  template void BasicFlowfield<D, T, F>::save(const std::string& filename) const;
+
+INSTANTIATE_FLOWFIELD_IO(2, false, Float32)
+INSTANTIATE_FLOWFIELD_IO(2, false, Float16)
+INSTANTIATE_FLOWFIELD_IO(3, false, Float32)
+INSTANTIATE_FLOWFIELD_IO(3, false, Float16)
+INSTANTIATE_FLOWFIELD_IO(2, true, Float32)
+INSTANTIATE_FLOWFIELD_IO(2, true, Float16)
+INSTANTIATE_FLOWFIELD_IO(3, true, Float32)
+INSTANTIATE_FLOWFIELD_IO(3, true, Float16)
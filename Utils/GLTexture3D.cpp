@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "GLTexture3D.h"
 
 GLTexture3D::GLTexture3D(GLint magFilter, GLint minFilter, GLint wrapX, GLint wrapY, GLint wrapZ) :
@@ -14,7 +16,10 @@ GLTexture3D::GLTexture3D(GLint magFilter, GLint minFilter, GLint wrapX, GLint wr
   height(0),
   depth(0),
   componentCount(0),
-  isFloat(false)
+  isFloat(false),
+  shadowCopy(true),
+  unpackBuffers{0, 0},
+  nextUnpackBuffer(0)
 {
   GL(glGenTextures(1, &id));
   GL(glBindTexture(GL_TEXTURE_3D, id));
@@ -26,18 +31,15 @@ GLTexture3D::GLTexture3D(GLint magFilter, GLint minFilter, GLint wrapX, GLint wr
 }
 
 GLTexture3D::~GLTexture3D() {
+  if (unpackBuffers[0] != 0) GL(glDeleteBuffers(GLsizei(unpackBuffers.size()), unpackBuffers.data()));
   GL(glDeleteTextures(1, &id));
 }
 
 GLTexture3D::GLTexture3D(const GLTexture3D& other) :
   GLTexture3D(other.magFilter, other.minFilter, other.wrapX, other.wrapY, other.wrapZ)
 {
-  if (other.height > 0 && other.width > 0 && other.depth > 0) {
-    if (other.isFloat)
-      setData(other.fdata, other.height, other.width, other.depth, other.componentCount);
-    else
-      setData(other.data, other.height, other.width, other.depth, other.componentCount);
-  }
+  shadowCopy = other.shadowCopy;
+  copyData(other);
 }
 
 GLTexture3D& GLTexture3D::operator=(GLTexture3D other) {
@@ -53,11 +55,21 @@ GLTexture3D& GLTexture3D::operator=(GLTexture3D other) {
     GL(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, magFilter));
     GL(glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, minFilter));
     
-    if (other.height > 0 && other.width > 0 && other.depth > 0)
-      setData(other.data, other.height, other.width, other.depth, other.componentCount);
+    shadowCopy = other.shadowCopy;
+    copyData(other);
     return *this;
 }
 
+void GLTexture3D::copyData(const GLTexture3D& other) {
+  if (other.height == 0 || other.width == 0 || other.depth == 0) return;
+  if (other.isFloat)
+    setData(other.shadowCopy ? other.fdata : other.readBack<GLfloat>(),
+            other.width, other.height, other.depth, other.componentCount);
+  else
+    setData(other.shadowCopy ? other.data : other.readBack<GLubyte>(),
+            other.width, other.height, other.depth, other.componentCount);
+}
+
 const GLuint GLTexture3D::getId() const {
   return id;
 }
@@ -82,7 +94,7 @@ void GLTexture3D::setData(const std::vector<GLubyte>& data, uint32_t width, uint
     throw GLException{"Data size and texure dimensions do not match."};
   }
   
-  this->data = data;
+  if (shadowCopy) this->data = data;
   setData((GLvoid*)data.data(), width, height, depth, componentCount, false);
 }
 
@@ -91,10 +103,10 @@ void GLTexture3D::setData(const std::vector<GLfloat>& data) {
 }
 
 void GLTexture3D::setData(const std::vector<GLfloat>& data, uint32_t width, uint32_t height, uint32_t depth, uint8_t componentCount) {
-  if (data.size() != componentCount*width*height*depth*4) {
+  if (data.size() != componentCount*width*height*depth) {
     throw GLException{"Data size and texure dimensions do not match."};
   }
-  this->fdata = data;
+  if (shadowCopy) this->fdata = data;
   setData((GLvoid*)data.data(), width, height, depth, componentCount, true);
 }
 
@@ -135,20 +147,117 @@ void GLTexture3D::setData(GLvoid* data, uint32_t width, uint32_t height,
   GL(glTexImage3D(GL_TEXTURE_3D, 0, internalformat, GLsizei(width), GLsizei(height), GLsizei(depth), 0, format, type, data));
 }
 
-#ifndef __EMSCRIPTEN__
-const std::vector<GLubyte>& GLTexture3D::getDataByte() {
-  GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
-  GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+void GLTexture3D::setSubData(const std::vector<GLubyte>& data, uint32_t x, uint32_t y, uint32_t z,
+                             uint32_t width, uint32_t height, uint32_t depth) {
+  setSubData(data.data(), data.size(), false, x, y, z, width, height, depth, false);
+  if (shadowCopy) updateShadowCopy(this->data, data, x, y, z, width, height, depth);
+}
+
+void GLTexture3D::setSubData(const std::vector<GLfloat>& data, uint32_t x, uint32_t y, uint32_t z,
+                             uint32_t width, uint32_t height, uint32_t depth) {
+  setSubData(data.data(), data.size(), true, x, y, z, width, height, depth, false);
+  if (shadowCopy) updateShadowCopy(fdata, data, x, y, z, width, height, depth);
+}
+
+void GLTexture3D::streamSubData(const std::vector<GLubyte>& data, uint32_t x, uint32_t y, uint32_t z,
+                                uint32_t width, uint32_t height, uint32_t depth) {
+  setSubData(data.data(), data.size(), false, x, y, z, width, height, depth, true);
+  if (shadowCopy) updateShadowCopy(this->data, data, x, y, z, width, height, depth);
+}
+
+void GLTexture3D::streamSubData(const std::vector<GLfloat>& data, uint32_t x, uint32_t y, uint32_t z,
+                                uint32_t width, uint32_t height, uint32_t depth) {
+  setSubData(data.data(), data.size(), true, x, y, z, width, height, depth, true);
+  if (shadowCopy) updateShadowCopy(fdata, data, x, y, z, width, height, depth);
+}
+
+void GLTexture3D::setSubData(const GLvoid* data, size_t elementCount, bool isFloat,
+                             uint32_t x, uint32_t y, uint32_t z,
+                             uint32_t width, uint32_t height, uint32_t depth, bool stream) {
+  if (isFloat != this->isFloat) {
+    throw GLException{"Data type and texture type do not match."};
+  }
+  if (size_t(x)+width > this->width || size_t(y)+height > this->height || size_t(z)+depth > this->depth) {
+    throw GLException{"Box exceeds the texture dimensions."};
+  }
+  if (elementCount != size_t(componentCount)*width*height*depth) {
+    throw GLException{"Data size and box dimensions do not match."};
+  }
+
   GL(glBindTexture(GL_TEXTURE_3D, id));
-  GL(glGetTexImage(GL_TEXTURE_3D, 0, format, type, data.data()));
-  return data;
+  GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+
+  if (!stream) {
+    GL(glTexSubImage3D(GL_TEXTURE_3D, 0, GLint(x), GLint(y), GLint(z),
+                       GLsizei(width), GLsizei(height), GLsizei(depth), format, type, data));
+    return;
+  }
+
+  if (unpackBuffers[0] == 0) GL(glGenBuffers(GLsizei(unpackBuffers.size()), unpackBuffers.data()));
+  const GLuint buffer = unpackBuffers[nextUnpackBuffer];
+  nextUnpackBuffer = (nextUnpackBuffer + 1) % unpackBuffers.size();
+
+  // respecifying the store orphans the previous contents, so the copy does
+  // not wait for a transfer from this buffer that is still in flight
+  const size_t byteCount = elementCount * (isFloat ? sizeof(GLfloat) : sizeof(GLubyte));
+  GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer));
+  GL(glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(byteCount), data, GL_STREAM_DRAW));
+  GL(glTexSubImage3D(GL_TEXTURE_3D, 0, GLint(x), GLint(y), GLint(z),
+                     GLsizei(width), GLsizei(height), GLsizei(depth), format, type, nullptr));
+  GL(glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0));
 }
 
-const std::vector<GLfloat>& GLTexture3D::getDataFloat() {
+template <typename T>
+void GLTexture3D::updateShadowCopy(std::vector<T>& target, const std::vector<T>& box,
+                                   uint32_t x, uint32_t y, uint32_t z,
+                                   uint32_t width, uint32_t height, uint32_t depth) const {
+  const size_t rowSize = size_t(width) * componentCount;
+  for (size_t w = 0;w<depth;++w) {
+    for (size_t v = 0;v<height;++v) {
+      const size_t source = (v + w * height) * rowSize;
+      const size_t dest = ((x + (y + v) * size_t(this->width)) + (z + w) * size_t(this->width) * this->height) * componentCount;
+      std::copy(box.data() + source, box.data() + source + rowSize, target.data() + dest);
+    }
+  }
+}
+
+void GLTexture3D::setShadowCopy(bool enabled) {
+  if (enabled == shadowCopy) return;
+  shadowCopy = enabled;
+  if (!enabled) {
+    std::vector<GLubyte>().swap(data);
+    std::vector<GLfloat>().swap(fdata);
+  } else if (width > 0 && height > 0 && depth > 0) {
+    if (isFloat)
+      fdata = readBack<GLfloat>();
+    else
+      data = readBack<GLubyte>();
+  }
+}
+
+template <typename T>
+std::vector<T> GLTexture3D::readBack() const {
+#ifdef __EMSCRIPTEN__
+  throw GLException{"Reading back 3D textures is not supported."};
+#else
+  std::vector<T> result(size_t(width)*height*depth*componentCount);
   GL(glPixelStorei(GL_PACK_ALIGNMENT, 1));
-  GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
   GL(glBindTexture(GL_TEXTURE_3D, id));
-  GL(glGetTexImage(GL_TEXTURE_3D, 0, format, type, fdata.data()));
+  GL(glGetTexImage(GL_TEXTURE_3D, 0, format, type, result.data()));
+  return result;
+#endif
+}
+
+#ifndef __EMSCRIPTEN__
+std::vector<GLubyte> GLTexture3D::getDataByte() {
+  if (!shadowCopy) return readBack<GLubyte>();
+  data = readBack<GLubyte>();
+  return data;
+}
+
+std::vector<GLfloat> GLTexture3D::getDataFloat() {
+  if (!shadowCopy) return readBack<GLfloat>();
+  fdata = readBack<GLfloat>();
   return fdata;
 }
 #endif
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <vector>
 
 #include "GLEnv.h"  
@@ -21,6 +22,24 @@ public:
   void setData(const std::vector<GLfloat>& data, uint32_t width, uint32_t height, uint32_t depth, uint8_t componentCount=4);
   void setData(const std::vector<GLfloat>& data);
 
+  // replaces the box of the given size at (x,y,z), the data has to match
+  // the type and component count of the texture
+  void setSubData(const std::vector<GLubyte>& data, uint32_t x, uint32_t y, uint32_t z,
+                  uint32_t width, uint32_t height, uint32_t depth);
+  void setSubData(const std::vector<GLfloat>& data, uint32_t x, uint32_t y, uint32_t z,
+                  uint32_t width, uint32_t height, uint32_t depth);
+  // as setSubData, but the box is staged in one of two alternating pixel
+  // unpack buffers, so the transfer into the texture does not block the caller
+  void streamSubData(const std::vector<GLubyte>& data, uint32_t x, uint32_t y, uint32_t z,
+                     uint32_t width, uint32_t height, uint32_t depth);
+  void streamSubData(const std::vector<GLfloat>& data, uint32_t x, uint32_t y, uint32_t z,
+                     uint32_t width, uint32_t height, uint32_t depth);
+
+  // without the CPU side copy of the texture, copies of this object and
+  // getDataByte/getDataFloat read the texture back from the GPU instead
+  void setShadowCopy(bool enabled);
+  bool hasShadowCopy() const {return shadowCopy;}
+
   uint32_t getHeight() const {return height;}
   uint32_t getWidth() const {return width;}
   uint32_t getDepth() const {return depth;}
@@ -29,8 +48,10 @@ public:
   bool getIsFloat() const {return isFloat;}
   
 #ifndef __EMSCRIPTEN__
-  const std::vector<GLubyte>& getDataByte();
-  const std::vector<GLfloat>& getDataFloat();
+  // read the texture back from the GPU, the shadow copy is refreshed only
+  // if it is enabled
+  std::vector<GLubyte> getDataByte();
+  std::vector<GLfloat> getDataFloat();
 #endif
   
 private:
@@ -51,7 +72,20 @@ private:
   uint32_t depth;
   uint8_t componentCount;
   bool isFloat;
+  bool shadowCopy;
+  std::array<GLuint,2> unpackBuffers;
+  size_t nextUnpackBuffer;
   
   void setData(GLvoid* data, uint32_t width, uint32_t height, uint32_t depth, 
                uint8_t componentCount, bool isFloat);
+  void setSubData(const GLvoid* data, size_t elementCount, bool isFloat,
+                  uint32_t x, uint32_t y, uint32_t z,
+                  uint32_t width, uint32_t height, uint32_t depth, bool stream);
+  template <typename T>
+  void updateShadowCopy(std::vector<T>& target, const std::vector<T>& box,
+                        uint32_t x, uint32_t y, uint32_t z,
+                        uint32_t width, uint32_t height, uint32_t depth) const;
+  template <typename T>
+  std::vector<T> readBack() const;
+  void copyData(const GLTexture3D& other);
 };
@@ -0,0 +1,35 @@
+#include "GLTimerQuery.h"
+
+GLTimerQuery::GLTimerQuery() :
+  id(0),
+  pending(false)
+{
+  GL(glGenQueries(1, &id));
+}
+
+GLTimerQuery::~GLTimerQuery() {
+  GL(glDeleteQueries(1, &id));
+}
+
+void GLTimerQuery::begin() {
+  GL(glBeginQuery(GL_TIME_ELAPSED, id));
+}
+
+void GLTimerQuery::end() {
+  GL(glEndQuery(GL_TIME_ELAPSED));
+  pending = true;
+}
+
+bool GLTimerQuery::poll(double& milliseconds) {
+  if (!pending) return false;
+
+  GLint available = 0;
+  GL(glGetQueryObjectiv(id, GL_QUERY_RESULT_AVAILABLE, &available));
+  if (!available) return false;
+
+  GLuint64 nanoseconds = 0;
+  GL(glGetQueryObjectui64v(id, GL_QUERY_RESULT, &nanoseconds));
+  milliseconds = double(nanoseconds) / 1e6;
+  pending = false;
+  return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "GLEnv.h"
+
+// Measures the GPU time of the commands between begin and end. The result
+// is polled without stalling the pipeline, so a new measurement can only be
+// started once the previous one has been retrieved.
+class GLTimerQuery {
+public:
+  GLTimerQuery();
+  ~GLTimerQuery();
+
+  void begin();
+  void end();
+
+  bool isPending() const {return pending;}
+  bool poll(double& milliseconds);
+
+private:
+  GLuint id;
+  bool pending;
+};
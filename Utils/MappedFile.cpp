@@ -0,0 +1,89 @@
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+static std::runtime_error mappingError(const std::string& filename) {
+  std::stringstream s;
+  s << "Can't map file " << filename;
+  return std::runtime_error(s.str());
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) :
+  begin(nullptr),
+  length(0),
+  file(INVALID_HANDLE_VALUE),
+  mapping(nullptr)
+{
+  file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                     OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) throw mappingError(filename);
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw mappingError(filename);
+  }
+  length = size_t(fileSize.QuadPart);
+  if (length == 0) return;
+
+  mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping) begin = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!begin) {
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    throw mappingError(filename);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (begin) UnmapViewOfFile(begin);
+  if (mapping) CloseHandle(mapping);
+  CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) :
+  begin(nullptr),
+  length(0),
+  descriptor(-1)
+{
+  descriptor = open(filename.c_str(), O_RDONLY);
+  if (descriptor < 0) throw mappingError(filename);
+
+  struct stat info;
+  if (fstat(descriptor, &info) != 0) {
+    close(descriptor);
+    throw mappingError(filename);
+  }
+  length = size_t(info.st_size);
+  if (length == 0) return;
+
+  void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  if (address == MAP_FAILED) {
+    close(descriptor);
+    throw mappingError(filename);
+  }
+  begin = static_cast<const char*>(address);
+}
+
+MappedFile::~MappedFile() {
+  if (begin) munmap(const_cast<char*>(begin), length);
+  close(descriptor);
+}
+
+#endif
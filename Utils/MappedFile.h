@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+// Read-only memory mapping of a whole file, throws std::runtime_error if
+// the file can not be opened or mapped
+class MappedFile {
+public:
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const {return begin;}
+  size_t size() const {return length;}
+
+private:
+  const char* begin;
+  size_t length;
+#ifdef _WIN32
+  void* file;
+  void* mapping;
+#else
+  int descriptor;
+#endif
+};
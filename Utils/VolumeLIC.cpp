@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "Flowfield.h"
+#include "Rand.h"
+#include "VolumeLIC.h"
+
+VolumeLIC::VolumeLIC(const VolumeLICSettings& settings) :
+  settings(settings),
+  noiseVoxelCount(0),
+  streamlineCount(0),
+  evaluationCount(0)
+{
+}
+
+Volume VolumeLIC::genSparseNoise(size_t width, size_t height, size_t depth, float density, uint32_t seed) {
+  Volume noise;
+  noise.width = width;
+  noise.height = height;
+  noise.depth = depth;
+  noise.scale = Vec3{1.0f, 1.0f, 1.0f};
+  noise.normalizeScale();
+  noise.data.resize(width*height*depth);
+  if (density <= 0.0f) return noise;
+
+  // the gaps between noise voxels are geometrically distributed, so only
+  // the non-zero voxels cost random numbers
+  Random random(seed);
+  const double logInverse = std::log(1.0 - std::min(double(density), 0.999999));
+  size_t index = size_t(std::log(1.0 - double(random.rand01())) / logInverse);
+  while (index < noise.data.size()) {
+    noise.data[index] = uint8_t(128 + random.rand<int>(0, 127));
+    index += 1 + size_t(std::log(1.0 - double(random.rand01())) / logInverse);
+  }
+  return noise;
+}
+
+template <typename Field>
+size_t VolumeLIC::integrate(const Field& flow, const size_t size[3], Vec3 pos, float direction,
+                            std::vector<uint32_t>& voxels, std::vector<float>& values, bool& truncated) const {
+  const Vec3 extent{float(size[0]), float(size[1]), float(size[2])};
+  const float stepSize = settings.stepSize;
+  size_t evaluations = 0;
+  auto tangent = [&](const Vec3& p, Vec3& t) {
+    const Vec3 v = flow.interpolate(p / extent) * extent;
+    ++evaluations;
+    const float length = v.length();
+    if (length < 1e-12f) return false;
+    t = v * (direction / length);
+    return true;
+  };
+
+  uint32_t previous = uint32_t(size_t(pos.x) + size[0]*(size_t(pos.y) + size[1]*size_t(pos.z)));
+  size_t samplesWithoutNoise = 0;
+  const size_t maxSamples = std::max(settings.streamlineLength, settings.kernelLength);
+  truncated = false;
+  for (size_t i = 0;i<maxSamples;++i) {
+    Vec3 t;
+    if (!tangent(pos, t) || !tangent(pos + t*(stepSize*0.5f), t)) return evaluations;
+    pos = pos + t*stepSize;
+    if (pos.x < 0.0f || pos.y < 0.0f || pos.z < 0.0f ||
+        pos.x >= extent.x || pos.y >= extent.y || pos.z >= extent.z) return evaluations;
+
+    // a voxel sampled several times in a row contributes its noise once
+    const uint32_t voxel = uint32_t(size_t(pos.x) + size[0]*(size_t(pos.y) + size[1]*size_t(pos.z)));
+    const float value = voxel == previous ? 0.0f : texture[voxel];
+    previous = voxel;
+    voxels.push_back(voxel);
+    values.push_back(value);
+
+    // beyond this point the kernel of every sample misses the noise seen
+    // so far, noise further on seeds its own streamline
+    samplesWithoutNoise = value > 0.0f ? 0 : samplesWithoutNoise+1;
+    if (samplesWithoutNoise > settings.kernelLength) return evaluations;
+  }
+  truncated = true;
+  return evaluations;
+}
+
+template <typename Field>
+size_t VolumeLIC::trace(const Field& flow, const size_t size[3], uint32_t seed, Line& line) {
+  const size_t kernelLength = settings.kernelLength;
+  const Vec3 seedPos{float(seed % size[0]) + 0.5f,
+                     float((seed / size[0]) % size[1]) + 0.5f,
+                     float(seed / (size[0]*size[1])) + 0.5f};
+
+  bool backwardTruncated, forwardTruncated;
+  line.backwardVoxels.clear();
+  line.backwardValues.clear();
+  size_t evaluations = integrate(flow, size, seedPos, -1.0f, line.backwardVoxels, line.backwardValues,
+                                 backwardTruncated);
+
+  line.voxels.assign(line.backwardVoxels.rbegin(), line.backwardVoxels.rend());
+  line.values.assign(line.backwardValues.rbegin(), line.backwardValues.rend());
+  line.voxels.push_back(seed);
+  line.values.push_back(texture[seed]);
+  evaluations += integrate(flow, size, seedPos, 1.0f, line.voxels, line.values, forwardTruncated);
+
+  // samples closer than kernelLength to an end that was cut off by the
+  // length limit lack part of their kernel, neither deposit nor cover them
+  const size_t begin = backwardTruncated ? kernelLength : 0;
+  const size_t end = forwardTruncated ? line.voxels.size() - kernelLength : line.voxels.size();
+  deposit(line, begin, end);
+  cover(line, begin, end);
+  return evaluations;
+}
+
+void VolumeLIC::deposit(const Line& line, size_t begin, size_t end) {
+  const size_t kernelLength = settings.kernelLength;
+  const size_t count = line.values.size();
+
+  // unnormalized box filter over [i-kernelLength, i+kernelLength] clipped
+  // to the line, every noise voxel paints a streak of its own value
+  size_t low = begin > kernelLength ? begin - kernelLength : 0;
+  size_t high = std::min(count, begin + kernelLength + 1);
+  double sum = 0.0;
+  for (size_t j = low;j<high;++j) sum += line.values[j];
+
+  for (size_t i = begin;i<end;++i) {
+    if (sum > 1e-3) {
+      const uint32_t voxel = line.voxels[i];
+      const float value = std::min(float(sum), 1.0f);
+      sums[voxel].fetch_add(uint32_t(value * fixedPointScale + 0.5f), std::memory_order_relaxed);
+      hits[voxel].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (i >= kernelLength) sum -= line.values[low++];
+    if (high < count) sum += line.values[high++];
+  }
+}
+
+void VolumeLIC::cover(const Line& line, size_t begin, size_t end) {
+  for (size_t i = begin;i<end;++i) {
+    if (line.values[i] <= 0.0f) continue;
+    const auto seed = std::lower_bound(seeds.begin(), seeds.end(), line.voxels[i]);
+    covered[size_t(seed - seeds.begin())].store(1, std::memory_order_relaxed);
+  }
+}
+
+template <typename Field>
+Volume VolumeLIC::compute(const Field& flow) {
+  return compute(flow, genSparseNoise(flow.getSizeX(), flow.getSizeY(), flow.getSizeZ(),
+                                      settings.noiseDensity, settings.noiseSeed));
+}
+
+template <typename Field>
+Volume VolumeLIC::compute(const Field& flow, const Volume& noise) {
+  const size_t size[3] = {noise.width, noise.height, noise.depth};
+  const size_t voxelCount = size[0]*size[1]*size[2];
+  if (voxelCount > std::numeric_limits<uint32_t>::max()) {
+    std::stringstream s;
+    s << "Volume of size " << size[0] << "x" << size[1] << "x" << size[2] << " is too large for the LIC";
+    throw std::runtime_error(s.str());
+  }
+
+  texture.resize(voxelCount);
+  if (sums.size() != voxelCount) {
+    std::vector<std::atomic<uint32_t>>(voxelCount).swap(sums);
+    std::vector<std::atomic<uint32_t>>(voxelCount).swap(hits);
+  }
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(voxelCount);++i) {
+    texture[size_t(i)] = noise.data[size_t(i)] / 255.0f;
+    sums[size_t(i)].store(0, std::memory_order_relaxed);
+    hits[size_t(i)].store(0, std::memory_order_relaxed);
+  }
+
+  seeds.clear();
+  for (size_t i = 0;i<voxelCount;++i) {
+    if (noise.data[i] > 0) seeds.push_back(uint32_t(i));
+  }
+  std::vector<std::atomic<uint8_t>>(seeds.size()).swap(covered);
+  for (std::atomic<uint8_t>& c : covered) c.store(0, std::memory_order_relaxed);
+  noiseVoxelCount = seeds.size();
+
+  // seeds are sorted by index, so every slab of z layers is a range of them
+  const size_t slabCount = (size[2] + slabDepth - 1) / slabDepth;
+  std::vector<size_t> slabBegin(slabCount+1);
+  for (size_t slab = 0;slab<=slabCount;++slab) {
+    const size_t first = std::min(slab*slabDepth, size[2])*size[0]*size[1];
+    slabBegin[slab] = size_t(std::lower_bound(seeds.begin(), seeds.end(), first) - seeds.begin());
+  }
+
+  size_t lines = 0;
+  size_t evaluations = 0;
+  #pragma omp parallel reduction(+:lines,evaluations)
+  {
+    Line line;
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t slab = 0;slab<int64_t(slabCount);++slab) {
+      for (size_t i = slabBegin[size_t(slab)];i<slabBegin[size_t(slab)+1];++i) {
+        if (covered[i].load(std::memory_order_relaxed)) continue;
+        evaluations += trace(flow, size, seeds[i], line);
+        ++lines;
+      }
+    }
+  }
+  streamlineCount = lines;
+  evaluationCount = evaluations;
+
+  Volume result;
+  result.width = size[0];
+  result.height = size[1];
+  result.depth = size[2];
+  result.scale = Vec3{1.0f, 1.0f, 1.0f};
+  result.normalizeScale();
+  result.data.resize(voxelCount);
+  #pragma omp parallel for
+  for (int64_t i = 0;i<int64_t(voxelCount);++i) {
+    const uint32_t count = hits[size_t(i)].load(std::memory_order_relaxed);
+    if (count == 0) continue;
+    const float value = float(sums[size_t(i)].load(std::memory_order_relaxed)) / (fixedPointScale * count);
+    result.data[size_t(i)] = uint8_t(std::min(value, 1.0f) * 255.0f + 0.5f);
+  }
+  return result;
+}
+
+template Volume VolumeLIC::compute<Flowfield>(const Flowfield& flow);
+template Volume VolumeLIC::compute<HalfFlowfield>(const HalfFlowfield& flow);
+template Volume VolumeLIC::compute<Flowfield>(const Flowfield& flow, const Volume& noise);
+template Volume VolumeLIC::compute<HalfFlowfield>(const HalfFlowfield& flow, const Volume& noise);
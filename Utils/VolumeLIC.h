@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "Volume.h"
+
+struct VolumeLICSettings {
+  size_t kernelLength{16};        // samples on each side of the box filter
+  size_t streamlineLength{200};   // samples per direction of one streamline
+  float stepSize{0.5f};           // in voxels
+  float noiseDensity{0.005f};     // fraction of non-zero voxels in generated noise
+  uint32_t noiseSeed{42};
+};
+
+// Line integral convolution of a 3D field with sparse noise, the result
+// is a volume of the size of the noise for the raycaster and isosurfaces.
+// With sparse noise the convolution is zero away from the streamlines
+// through non-zero noise voxels, so only those voxels seed streamlines
+// (RK2 along the normalized field, constant step in voxels). Like FastLIC
+// a box filter slides along every streamline and deposits in all voxels
+// it crosses, the noise voxels it passes count as done and do not seed
+// again. A streamline stops once it went kernelLength samples without
+// meeting noise. Seeds are processed in z slabs in parallel, deposits use
+// atomic updates and each voxel is the average of its deposits.
+class VolumeLIC {
+public:
+  VolumeLIC(const VolumeLICSettings& settings=VolumeLICSettings{});
+
+  // uses sparse noise of the size of the flow field
+  template <typename Field>
+  Volume compute(const Field& flow);
+  template <typename Field>
+  Volume compute(const Field& flow, const Volume& noise);
+
+  // values in [128,255] at the given fraction of random voxels, 0 elsewhere
+  static Volume genSparseNoise(size_t width, size_t height, size_t depth, float density, uint32_t seed);
+
+  void setSettings(const VolumeLICSettings& settings) {this->settings = settings;}
+  const VolumeLICSettings& getSettings() const {return settings;}
+
+  size_t getNoiseVoxelCount() const {return noiseVoxelCount;}
+  size_t getStreamlineCount() const {return streamlineCount;}
+  size_t getEvaluationCount() const {return evaluationCount;}
+
+private:
+  static constexpr size_t slabDepth = 4;
+  // deposited values are summed in 20.12 fixed point to allow atomic adds
+  static constexpr float fixedPointScale = 4096.0f;
+
+  VolumeLICSettings settings;
+  size_t noiseVoxelCount;
+  size_t streamlineCount;
+  size_t evaluationCount;
+
+  std::vector<float> texture;
+  // non-zero noise voxels in ascending order and whether a streamline
+  // already carried their contribution
+  std::vector<uint32_t> seeds;
+  std::vector<std::atomic<uint8_t>> covered;
+  std::vector<std::atomic<uint32_t>> sums;
+  std::vector<std::atomic<uint32_t>> hits;
+
+  // the samples of one streamline from its backward to its forward end
+  struct Line {
+    std::vector<uint32_t> voxels;
+    std::vector<float> values;
+    std::vector<uint32_t> backwardVoxels;
+    std::vector<float> backwardValues;
+  };
+
+  template <typename Field>
+  size_t trace(const Field& flow, const size_t size[3], uint32_t seed, Line& line);
+  template <typename Field>
+  size_t integrate(const Field& flow, const size_t size[3], Vec3 pos, float direction,
+                   std::vector<uint32_t>& voxels, std::vector<float>& values, bool& truncated) const;
+  void deposit(const Line& line, size_t begin, size_t end);
+  void cover(const Line& line, size_t begin, size_t end);
+};